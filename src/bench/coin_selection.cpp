@@ -57,4 +57,29 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// Wallets of stakers and pools hold a lot of small outputs. Select from
+// 100k of them, which is handled by branch and bound instead of the
+// stochastic approximation.
+static void CoinSelectionLargeWallet(benchmark::State& state)
+{
+    const CWallet wallet;
+    std::vector<COutput> vCoins;
+    LOCK(wallet.cs_wallet);
+
+    for (int i = 0; i < 100000; i++)
+        addCoin((1 + i % 997) * CENT, wallet, vCoins);
+
+    while (state.KeepRunning()) {
+        std::set<CInputCoin> setCoinsRet;
+        CAmount nValueRet;
+        bool success = wallet.SelectCoinsMinConf(1234 * COIN + 5678, 1, 6, 0, vCoins, setCoinsRet, nValueRet);
+        assert(success);
+        assert(nValueRet >= 1234 * COIN + 5678);
+    }
+
+    for (COutput output : vCoins)
+        delete output.tx;
+}
+
 BENCHMARK(CoinSelection);
+BENCHMARK(CoinSelectionLargeWallet);
@@ -10,19 +10,200 @@
 #include "evo/providertx.h"
 #include "evo/cbtx.h"
 #include "llmq/quorums_commitment.h"
+#include "core_memusage.h"
 #include "hash.h"
+#include "memusage.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "random.h"
+#include "saltedhasher.h"
 #include "streams.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
 
 #include <math.h>
 #include <stdlib.h>
 
+#include <list>
+#include <unordered_map>
+
 
 #define LN2SQUARED 0.4804530139182014246671025263266649717305529515945455
 #define LN2 0.6931471805599453094172321214581765680755001343602552
 
+static std::vector<unsigned char> SerializeOutPoint(const COutPoint& outpoint)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << outpoint;
+    return std::vector<unsigned char>(stream.begin(), stream.end());
+}
+
+// Same elements as CBloomFilter::CheckScript tests, stopping at the first invalid opcode
+static std::vector<std::vector<unsigned char> > ExtractPushes(const CScript& script)
+{
+    std::vector<std::vector<unsigned char> > vPushes;
+    CScript::const_iterator pc = script.begin();
+    std::vector<unsigned char> data;
+    while (pc < script.end()) {
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode, data))
+            break;
+        if (data.size() != 0)
+            vPushes.push_back(data);
+    }
+    return vPushes;
+}
+
+CBloomTxElements::CBloomTxElements(const CTransaction& txIn) :
+    tx(txIn)
+{
+    Extract();
+}
+
+CBloomTxElements::CBloomTxElements(const CTransactionRef& txIn) :
+    txRef(txIn),
+    tx(*txIn)
+{
+    Extract();
+}
+
+void CBloomTxElements::Extract()
+{
+    const uint256& hash = tx.GetHash();
+    vHash.assign(hash.begin(), hash.end());
+
+    vOutputs.resize(tx.vout.size());
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        Output& output = vOutputs[i];
+        output.vPushes = ExtractPushes(tx.vout[i].scriptPubKey);
+        if (output.vPushes.empty())
+            continue; // can't match any filter
+        output.vOutPoint = SerializeOutPoint(COutPoint(hash, i));
+        txnouttype type;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        output.fPubKeyOrMultisig = Solver(tx.vout[i].scriptPubKey, type, vSolutions) &&
+                (type == TX_PUBKEY || type == TX_MULTISIG);
+    }
+
+    vInputs.resize(tx.vin.size());
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        vInputs[i].vPrevOut = SerializeOutPoint(tx.vin[i].prevout);
+        vInputs[i].vPushes = ExtractPushes(tx.vin[i].scriptSig);
+    }
+}
+
+size_t CBloomTxElements::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(vHash) + memusage::DynamicUsage(vOutputs) + memusage::DynamicUsage(vInputs);
+    for (const auto& output : vOutputs) {
+        nUsage += memusage::DynamicUsage(output.vPushes) + memusage::DynamicUsage(output.vOutPoint);
+        for (const auto& data : output.vPushes)
+            nUsage += memusage::DynamicUsage(data);
+    }
+    for (const auto& input : vInputs) {
+        nUsage += memusage::DynamicUsage(input.vPushes) + memusage::DynamicUsage(input.vPrevOut);
+        for (const auto& data : input.vPushes)
+            nUsage += memusage::DynamicUsage(data);
+    }
+    if (txRef)
+        nUsage += RecursiveDynamicUsage(txRef);
+    return nUsage;
+}
+
+/**
+ * Transactions are relayed to many filtered peers at once. Least recently used
+ * elements are evicted first once the cache exceeds BLOOM_TX_ELEMENTS_CACHE_USAGE.
+ */
+class CBloomTxElementsCache
+{
+private:
+    struct Entry {
+        uint256 hash;
+        std::shared_ptr<const CBloomTxElements> elements;
+        size_t nUsage;
+    };
+    typedef std::list<Entry> List;
+
+    CCriticalSection cs;
+    List entries; //!< most recently used first
+    std::unordered_map<uint256, List::iterator, StaticSaltedHasher> mapEntries;
+    size_t nUsage{0}; //!< sum of the usage of all entries
+
+    size_t DynamicMemoryUsage() const
+    {
+        // a list node holds the entry and two pointers
+        return nUsage + memusage::DynamicUsage(mapEntries) +
+               memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) * entries.size();
+    }
+
+public:
+    bool Get(const uint256& hash, std::shared_ptr<const CBloomTxElements>& elementsRet)
+    {
+        LOCK(cs);
+        auto it = mapEntries.find(hash);
+        if (it == mapEntries.end())
+            return false;
+        entries.splice(entries.begin(), entries, it->second);
+        elementsRet = it->second->elements;
+        return true;
+    }
+
+    void Insert(const uint256& hash, const std::shared_ptr<const CBloomTxElements>& elements)
+    {
+        const size_t nEntryUsage = memusage::DynamicUsage(elements) + elements->DynamicMemoryUsage();
+        LOCK(cs);
+        if (mapEntries.count(hash) || nEntryUsage > BLOOM_TX_ELEMENTS_CACHE_USAGE)
+            return;
+        entries.push_front(Entry{hash, elements, nEntryUsage});
+        mapEntries.emplace(hash, entries.begin());
+        nUsage += nEntryUsage;
+        while (DynamicMemoryUsage() > BLOOM_TX_ELEMENTS_CACHE_USAGE) {
+            nUsage -= entries.back().nUsage;
+            mapEntries.erase(entries.back().hash);
+            entries.pop_back();
+        }
+    }
+};
+
+static CBloomTxElementsCache bloomTxElementsCache;
+
+std::shared_ptr<const CBloomTxElements> GetBloomTxElements(const CTransactionRef& tx)
+{
+    std::shared_ptr<const CBloomTxElements> elements;
+    if (bloomTxElementsCache.Get(tx->GetHash(), elements))
+        return elements;
+    elements = std::make_shared<const CBloomTxElements>(tx);
+    bloomTxElementsCache.Insert(tx->GetHash(), elements);
+    return elements;
+}
+
+// New blocks are requested by all filtered peers at about the same time
+static CCriticalSection cs_bloomBlockElementsCache;
+static unordered_lru_cache<uint256, std::shared_ptr<const CBloomBlockElements>, StaticSaltedHasher, BLOOM_BLOCK_ELEMENTS_CACHE_SIZE> bloomBlockElementsCache;
+
+std::shared_ptr<const CBloomBlockElements> GetBloomBlockElements(const uint256& hashBlock, const std::vector<CTransactionRef>& vtx)
+{
+    std::shared_ptr<const CBloomBlockElements> elements;
+    {
+        LOCK(cs_bloomBlockElementsCache);
+        if (bloomBlockElementsCache.get(hashBlock, elements))
+            return elements;
+    }
+    auto vElements = std::make_shared<CBloomBlockElements>();
+    vElements->reserve(vtx.size());
+    for (const auto& tx : vtx) {
+        // Don't evict relayed transactions for the ones of a block, each block has its own entry
+        std::shared_ptr<const CBloomTxElements> txElements;
+        if (!bloomTxElementsCache.Get(tx->GetHash(), txElements))
+            txElements = std::make_shared<const CBloomTxElements>(tx);
+        vElements->push_back(std::move(txElements));
+    }
+    elements = vElements;
+    LOCK(cs_bloomBlockElementsCache);
+    bloomBlockElementsCache.insert(hashBlock, elements);
+    return elements;
+}
+
 CBloomFilter::CBloomFilter(const unsigned int nElements, const double nFPRate, const unsigned int nTweakIn, unsigned char nFlagsIn) :
     /**
      * The ideal size for a bloom filter with a given number of elements and false positive rate is:
@@ -75,10 +256,7 @@ void CBloomFilter::insert(const std::vector<unsigned char>& vKey)
 
 void CBloomFilter::insert(const COutPoint& outpoint)
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    insert(data);
+    insert(SerializeOutPoint(outpoint));
 }
 
 void CBloomFilter::insert(const uint256& hash)
@@ -105,10 +283,7 @@ bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
 
 bool CBloomFilter::contains(const COutPoint& outpoint) const
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    return contains(data);
+    return contains(SerializeOutPoint(outpoint));
 }
 
 bool CBloomFilter::contains(const uint256& hash) const
@@ -156,6 +331,15 @@ bool CBloomFilter::CheckScript(const CScript &script) const
     return false;
 }
 
+bool CBloomFilter::CheckPushes(const std::vector<std::vector<unsigned char> >& vPushes) const
+{
+    for (const auto& data : vPushes) {
+        if (contains(data))
+            return true;
+    }
+    return false;
+}
+
 // If the transaction is a special transaction that has a registration
 // transaction hash, test the registration transaction hash.
 // If the transaction is a special transaction with any public keys or any
@@ -232,6 +416,15 @@ bool CBloomFilter::CheckSpecialTransactionMatchesAndUpdate(const CTransaction &t
 }
 
 bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
+{
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    return IsRelevantAndUpdate(CBloomTxElements(tx));
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CBloomTxElements& elements)
 {
     bool fFound = false;
     // Match if the filter contains the hash of tx
@@ -240,46 +433,38 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
         return true;
     if (isEmpty)
         return false;
-    const uint256& hash = tx.GetHash();
-    if (contains(hash))
+    if (contains(elements.vHash))
         fFound = true;
 
     // Check additional matches for special transactions
-    fFound = fFound || CheckSpecialTransactionMatchesAndUpdate(tx);
+    fFound = fFound || CheckSpecialTransactionMatchesAndUpdate(elements.tx);
 
-    for (unsigned int i = 0; i < tx.vout.size(); i++)
+    for (const auto& output : elements.vOutputs)
     {
-        const CTxOut& txout = tx.vout[i];
         // Match if the filter contains any arbitrary script data element in any scriptPubKey in tx
         // If this matches, also add the specific output that was matched.
         // This means clients don't have to update the filter themselves when a new relevant tx 
         // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
-        if(CheckScript(txout.scriptPubKey)) {
+        if(CheckPushes(output.vPushes)) {
             fFound = true;
             if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
-                insert(COutPoint(hash, i));
-            else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
-            {
-                txnouttype type;
-                std::vector<std::vector<unsigned char> > vSolutions;
-                if (Solver(txout.scriptPubKey, type, vSolutions) &&
-                        (type == TX_PUBKEY || type == TX_MULTISIG))
-                    insert(COutPoint(hash, i));
-            }
+                insert(output.vOutPoint);
+            else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY && output.fPubKeyOrMultisig)
+                insert(output.vOutPoint);
         }
     }
 
     if (fFound)
         return true;
 
-    for (const CTxIn& txin : tx.vin)
+    for (const auto& input : elements.vInputs)
     {
         // Match if the filter contains an outpoint tx spends
-        if (contains(txin.prevout))
+        if (contains(input.vPrevOut))
             return true;
 
         // Match if the filter contains any arbitrary script data element in any scriptSig in tx
-        if(CheckScript(txin.scriptSig))
+        if(CheckPushes(input.vPushes))
             return true;
     }
 
@@ -6,19 +6,22 @@
 #ifndef BITCOIN_BLOOM_H
 #define BITCOIN_BLOOM_H
 
+#include "primitives/transaction.h"
 #include "serialize.h"
 
+#include <memory>
 #include <vector>
 
-class COutPoint;
-class CScript;
-class CTransaction;
 class uint256;
 class uint160;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
 static const unsigned int MAX_HASH_FUNCS = 50;
+//! Memory usage of the filter elements kept for reuse when relaying transactions to filtered peers
+static const size_t BLOOM_TX_ELEMENTS_CACHE_USAGE = 8 << 20; // bytes
+//! Number of blocks whose filter elements are kept for the filtered peers requesting them
+static const unsigned int BLOOM_BLOCK_ELEMENTS_CACHE_SIZE = 2;
 
 /**
  * First two bits of nFlags control how much IsRelevantAndUpdate actually updates
@@ -33,6 +36,66 @@ enum bloomflags
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The data elements of a transaction which IsRelevantAndUpdate tests against a filter,
+ * extracted from the scripts and serialized once so that they can be shared by all
+ * filters checking the same transaction. The element hashes depend on each filter's
+ * nTweak, so only the extraction is shared.
+ */
+class CBloomTxElements
+{
+public:
+    struct Output {
+        //! Non-empty pushdatas of scriptPubKey
+        std::vector<std::vector<unsigned char> > vPushes;
+        //! Serialized COutPoint spending this output, inserted on a match
+        std::vector<unsigned char> vOutPoint;
+        //! Whether scriptPubKey is pay-to-pubkey or pay-to-multisig (BLOOM_UPDATE_P2PUBKEY_ONLY)
+        bool fPubKeyOrMultisig{false};
+    };
+    struct Input {
+        //! Serialized prevout
+        std::vector<unsigned char> vPrevOut;
+        //! Non-empty pushdatas of scriptSig
+        std::vector<std::vector<unsigned char> > vPushes;
+    };
+
+private:
+    // Keeps tx alive when the elements are cached
+    const CTransactionRef txRef;
+
+public:
+    const CTransaction& tx;
+    std::vector<unsigned char> vHash;
+    std::vector<Output> vOutputs;
+    std::vector<Input> vInputs;
+
+    explicit CBloomTxElements(const CTransaction& txIn);
+    explicit CBloomTxElements(const CTransactionRef& txIn);
+
+    //! Memory kept alive by these elements, including the transaction
+    size_t DynamicMemoryUsage() const;
+
+private:
+    void Extract();
+};
+
+/**
+ * Returns the filter elements of a relayed tx, shared with all other filtered peers it is
+ * relayed to while it stays in the cache (bounded by BLOOM_TX_ELEMENTS_CACHE_USAGE).
+ */
+std::shared_ptr<const CBloomTxElements> GetBloomTxElements(const CTransactionRef& tx);
+
+//! Filter elements of the transactions of a block, in block order
+typedef std::vector<std::shared_ptr<const CBloomTxElements> > CBloomBlockElements;
+
+/**
+ * Returns the filter elements of all transactions of a block, shared by all filtered peers
+ * requesting the block while it is one of the last BLOOM_BLOCK_ELEMENTS_CACHE_SIZE ones
+ * requested. Elements of recently relayed transactions are taken from the relay cache.
+ */
+std::shared_ptr<const CBloomBlockElements> GetBloomBlockElements(const uint256& hashBlock, const std::vector<CTransactionRef>& vtx);
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we send them.
@@ -62,6 +125,8 @@ private:
 
     // Check matches for arbitrary script data elements
     bool CheckScript(const CScript& script) const;
+    // Same as CheckScript for already extracted script data elements
+    bool CheckPushes(const std::vector<std::vector<unsigned char> >& vPushes) const;
     // Check additional matches for special transactions
     bool CheckSpecialTransactionMatchesAndUpdate(const CTransaction& tx);
 public:
@@ -105,6 +170,10 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    bool IsRelevantAndUpdate(const CBloomTxElements& elements);
+
+    //! Whether IsRelevantAndUpdate may change the filter, so matches depend on the transactions seen before
+    bool IsUpdating() const { return !isFull && !isEmpty && (nFlags & BLOOM_UPDATE_MASK) != BLOOM_UPDATE_NONE; }
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSTATS_H
+#define BITCOIN_COINSTATS_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "serialize.h"
+#include "uint256.h"
+
+class COutPoint;
+class Coin;
+
+/**
+ * Running statistics of the UTXO set at hashBlock.
+ *
+ * The set hash is a MuHash of all serialized coins, so it can be updated coin
+ * by coin while blocks are connected and disconnected instead of walking the
+ * whole coins database.
+ */
+class CUTXOStats
+{
+public:
+    uint256 hashBlock;
+    MuHash3072 muhash;
+    uint64_t nTransactionOutputs;
+    uint64_t nBogoSize;
+    CAmount nTotalAmount;
+
+    CUTXOStats() : nTransactionOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(muhash);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nBogoSize);
+        READWRITE(nTotalAmount);
+    }
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+
+    /** Hash of the UTXO set, the (expensive) modular inverse is only done once per call */
+    uint256 GetHash() const;
+};
+
+/** Approximate serialized size of a coin as used by gettxoutsetinfo */
+uint64_t GetBogoSize(const Coin& coin);
+
+#endif // BITCOIN_COINSTATS_H
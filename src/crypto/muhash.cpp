@@ -0,0 +1,164 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/chacha20.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <string.h>
+
+namespace {
+
+/** 2^3072 - MAX_PRIME_DIFF is the largest 3072 bit safe prime */
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+/** Whether a fully carried number is at least the modulus */
+bool IsOverflow(const uint32_t* limbs)
+{
+    if (limbs[0] <= UINT32_MAX - MAX_PRIME_DIFF) return false;
+    for (size_t i = 1; i < Num3072::LIMBS; ++i) {
+        if (limbs[i] != UINT32_MAX) return false;
+    }
+    return true;
+}
+
+/** Subtract the modulus, i.e. add MAX_PRIME_DIFF and drop the 2^3072 carry */
+void SubtractModulus(uint32_t* limbs)
+{
+    uint64_t carry = MAX_PRIME_DIFF;
+    for (size_t i = 0; i < Num3072::LIMBS && carry; ++i) {
+        uint64_t t = (uint64_t)limbs[i] + carry;
+        limbs[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (size_t i = 0; i < LIMBS; ++i) {
+        limbs[i] = ReadLE32(data + 4 * i);
+    }
+    if (IsOverflow(limbs)) SubtractModulus(limbs);
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (size_t i = 1; i < LIMBS; ++i) {
+        limbs[i] = 0;
+    }
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (size_t i = 0; i < LIMBS; ++i) {
+        WriteLE32(out + 4 * i, limbs[i]);
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook multiplication into a 6144 bit product
+    uint32_t product[2 * LIMBS] = {0};
+    for (size_t i = 0; i < LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < LIMBS; ++j) {
+            uint64_t t = (uint64_t)limbs[i] * a.limbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i + LIMBS] = (uint32_t)carry;
+    }
+
+    // high * 2^3072 + low is congruent to high * MAX_PRIME_DIFF + low
+    uint64_t carry = 0;
+    for (size_t i = 0; i < LIMBS; ++i) {
+        uint64_t t = (uint64_t)product[i + LIMBS] * MAX_PRIME_DIFF + product[i] + carry;
+        limbs[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    // Fold whatever overflowed beyond 3072 bits again, this converges after one or two rounds
+    while (carry) {
+        uint64_t add = carry * MAX_PRIME_DIFF;
+        carry = 0;
+        for (size_t i = 0; i < LIMBS && add; ++i) {
+            uint64_t t = (uint64_t)limbs[i] + add;
+            limbs[i] = (uint32_t)t;
+            add = t >> 32;
+        }
+        carry = add;
+    }
+    if (IsOverflow(limbs)) SubtractModulus(limbs);
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat: a^(p - 2) = a^-1 mod p, with p - 2 = 2^3072 - (MAX_PRIME_DIFF + 2)
+    const uint32_t nLowLimb = (uint32_t)(0 - (MAX_PRIME_DIFF + 2));
+    Num3072 result;
+    for (size_t i = LIMBS; i-- > 0;) {
+        const uint32_t nExponentLimb = i == 0 ? nLowLimb : UINT32_MAX;
+        for (int nBit = 31; nBit >= 0; --nBit) {
+            result.Multiply(result);
+            if ((nExponentLimb >> nBit) & 1) {
+                result.Multiply(*this);
+            }
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hash);
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    ChaCha20(hash, sizeof(hash)).Keystream(expanded, sizeof(expanded));
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char hash[OUTPUT_SIZE])
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(hash);
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** An element of the multiplicative group of integers modulo 2^3072 - 1103717 */
+class Num3072
+{
+public:
+    static const size_t LIMBS = 96;
+    static const size_t BYTE_SIZE = LIMBS * 4;
+
+private:
+    //! Little endian limbs, always fully reduced
+    uint32_t limbs[LIMBS];
+
+public:
+    Num3072() { SetToOne(); }
+    /** Interpret BYTE_SIZE little endian bytes as a number */
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    /** Serialize as BYTE_SIZE little endian bytes */
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+};
+
+/**
+ * A rolling, order independent hash of a set of byte strings (MuHash).
+ *
+ * Elements are hashed to numbers modulo a 3072 bit prime, the set is
+ * represented by the product of its elements. Adding and removing elements
+ * are a multiplication of the numerator respectively the denominator, so both
+ * are cheap, and the order of the operations doesn't matter. Only Finalize
+ * needs a modular inverse.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    static const size_t OUTPUT_SIZE = 32;
+
+    /** Hash of the empty set */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+    /** Add all elements of another set */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    /** Remove all elements of another set */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** SHA256 of the serialized set product, denominator is folded into the numerator */
+    void Finalize(unsigned char hash[OUTPUT_SIZE]);
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        numerator.ToBytes(data);
+        s.write((const char*)data, sizeof(data));
+        denominator.ToBytes(data);
+        s.write((const char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        s.read((char*)data, sizeof(data));
+        numerator = Num3072(data);
+        s.read((char*)data, sizeof(data));
+        denominator = Num3072(data);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
@@ -0,0 +1,276 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dbcompaction.h"
+
+#include "dbwrapper.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include "llmq/quorums_dkgsessionmgr.h"
+
+#include <sstream>
+
+#include <boost/thread.hpp>
+
+CDBCompactionManager dbCompactionManager;
+
+static bool IsDKGActive()
+{
+    return llmq::quorumDKGSessionManager && llmq::quorumDKGSessionManager->IsDKGActive();
+}
+
+/** Parse the per level table of the "leveldb.stats" property */
+static void ParseLevelDBStats(const std::string& strStats, CDBStats& stats)
+{
+    std::istringstream ssStats(strStats);
+    std::string strLine;
+    while (std::getline(ssStats, strLine)) {
+        // Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+        std::istringstream ssLine(strLine);
+        CDBStats::Level level;
+        double dTime, dReadMB, dWriteMB;
+        if (ssLine >> level.nLevel >> level.nFiles >> level.dSizeMB >> dTime >> dReadMB >> dWriteMB) {
+            stats.vLevels.push_back(level);
+            stats.dCompactionWrittenMB += dWriteMB;
+        }
+    }
+}
+
+double CDBStats::GetSizeMB() const
+{
+    double dSizeMB = 0;
+    for (const Level& level : vLevels) {
+        dSizeMB += level.dSizeMB;
+    }
+    return dSizeMB;
+}
+
+double CDBStats::GetWriteAmplification() const
+{
+    if (nBytesWritten == 0) {
+        return 0;
+    }
+    return dCompactionWrittenMB * (1 << 20) / nBytesWritten;
+}
+
+std::vector<CDBStats> CDBCompactionManager::GetStats() const
+{
+    std::vector<CDBStats> vStats;
+    ForEachDBWrapper([&](CDBWrapper& db) {
+        CDBStats stats;
+        stats.strName = db.GetName();
+        stats.nBytesWritten = db.GetBytesWritten();
+        stats.dCompactionWrittenMB = 0;
+        stats.nLastCompactionTime = 0;
+        std::string strStats;
+        if (db.GetProperty("leveldb.stats", strStats)) {
+            ParseLevelDBStats(strStats, stats);
+        }
+        vStats.push_back(stats);
+    });
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (CDBStats& stats : vStats) {
+        auto it = mapLastCompactionTime.find(stats.strName);
+        if (it != mapLastCompactionTime.end()) {
+            stats.nLastCompactionTime = it->second;
+        }
+    }
+    return vStats;
+}
+
+void CDBCompactionManager::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    if (!fAutoCompact || fInitialDownload || IsDKGActive()) {
+        return;
+    }
+
+    std::map<std::string, uint64_t> mapBytesWritten;
+    ForEachDBWrapper([&](CDBWrapper& db) {
+        mapBytesWritten.emplace(db.GetName(), db.GetBytesWritten());
+    });
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!queue.empty() || !strCompacting.empty()) {
+        return;
+    }
+
+    // Pick the database with the most writes since its last compaction
+    const int64_t nNow = GetTime();
+    std::string strBest;
+    uint64_t nBestWritten = 0;
+    for (const auto& p : mapBytesWritten) {
+        auto itTime = mapLastCompactionTime.find(p.first);
+        if (itTime != mapLastCompactionTime.end() && itTime->second + DB_COMPACTION_MIN_INTERVAL > nNow) {
+            continue;
+        }
+        uint64_t nWritten = p.second;
+        auto itWritten = mapBytesWrittenAtCompaction.find(p.first);
+        if (itWritten != mapBytesWrittenAtCompaction.end()) {
+            nWritten -= std::min(nWritten, itWritten->second);
+        }
+        if (nWritten >= DB_COMPACTION_MIN_BYTES_WRITTEN && nWritten > nBestWritten) {
+            strBest = p.first;
+            nBestWritten = nWritten;
+        }
+    }
+    if (!strBest.empty()) {
+        LogPrint(BCLog::LEVELDB, "CDBCompactionManager::%s -- compacting %s, %d MiB written since last compaction\n", __func__, strBest, nBestWritten >> 20);
+        queue.emplace_back(strBest, true);
+        cond.notify_one();
+    }
+}
+
+bool CDBCompactionManager::Enqueue(const std::string& strName)
+{
+    std::vector<std::string> vNames;
+    if (strName == "all") {
+        ForEachDBWrapper([&](CDBWrapper& db) {
+            vNames.push_back(db.GetName());
+        });
+    } else if (WithDBWrapper(strName, [](CDBWrapper&) {})) {
+        vNames.push_back(strName);
+    }
+    if (vNames.empty()) {
+        return false;
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (const std::string& strQueue : vNames) {
+        bool fQueued = strQueue == strCompacting;
+        for (const auto& entry : queue) {
+            fQueued |= entry.first == strQueue;
+        }
+        if (!fQueued) {
+            queue.emplace_back(strQueue, false);
+        }
+    }
+    cond.notify_one();
+    return true;
+}
+
+bool CDBCompactionManager::Abort()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (strCompacting.empty() && queue.empty()) {
+        return false;
+    }
+    queue.clear();
+    fAbort = true;
+    return true;
+}
+
+bool CDBCompactionManager::GetProgress(std::string& strNameRet, double& dProgressRet, std::vector<std::string>& vQueuedRet) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    strNameRet = strCompacting;
+    dProgressRet = dProgress;
+    vQueuedRet.clear();
+    for (const auto& entry : queue) {
+        vQueuedRet.push_back(entry.first);
+    }
+    return !strCompacting.empty() || !queue.empty();
+}
+
+namespace {
+/** A key range compacted in one step, see CDBWrapper::CompactPrefix */
+struct CompactionStep
+{
+    unsigned char nPrefix;
+    unsigned int nSubBegin;
+    unsigned int nSubEnd;
+    size_t nSize;
+};
+} // namespace
+
+bool CDBCompactionManager::CompactDB(const std::string& strName, bool fAutomatic)
+{
+    // Split the database into steps by key prefix, and large prefixes further
+    // by their second byte. Progress is weighed by the size on disk of a step.
+    std::vector<CompactionStep> vSteps;
+    size_t nTotalSize = 0;
+    if (!WithDBWrapper(strName, [&](CDBWrapper& db) {
+        for (unsigned int nPrefix = 0; nPrefix < 256; nPrefix++) {
+            size_t nPrefixSize = db.EstimatePrefixSize(nPrefix);
+            if (nPrefixSize == 0) {
+                continue;
+            }
+            unsigned int nParts = std::min<uint64_t>(256, (nPrefixSize + DB_COMPACTION_STEP_SIZE - 1) / DB_COMPACTION_STEP_SIZE);
+            if (nParts <= 1) {
+                vSteps.push_back({(unsigned char)nPrefix, 0, 256, nPrefixSize});
+                nTotalSize += nPrefixSize;
+                continue;
+            }
+            for (unsigned int nPart = 0; nPart < nParts; nPart++) {
+                unsigned int nSubBegin = nPart * 256 / nParts, nSubEnd = (nPart + 1) * 256 / nParts;
+                size_t nSize = db.EstimatePrefixSize(nPrefix, nSubBegin, nSubEnd);
+                vSteps.push_back({(unsigned char)nPrefix, nSubBegin, nSubEnd, nSize});
+                nTotalSize += nSize;
+            }
+        }
+    })) {
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    size_t nDoneSize = 0;
+    for (size_t i = 0; i < vSteps.size(); i++) {
+        const CompactionStep& step = vSteps[i];
+        boost::this_thread::interruption_point();
+        if (fAbort) {
+            LogPrintf("CDBCompactionManager::%s -- compaction of %s aborted\n", __func__, strName);
+            return false;
+        }
+        if (fAutomatic && IsDKGActive()) {
+            // Try again in the next quiet window
+            LogPrint(BCLog::LEVELDB, "CDBCompactionManager::%s -- DKG started, pausing compaction of %s\n", __func__, strName);
+            return false;
+        }
+
+        // Only holds the database open, the step runs without any global lock
+        if (!WithDBWrapper(strName, [&](CDBWrapper& db) { db.CompactPrefix(step.nPrefix, step.nSubBegin, step.nSubEnd); })) {
+            return false;
+        }
+
+        nDoneSize += step.nSize;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        dProgress = nTotalSize ? (double)nDoneSize / nTotalSize : (double)(i + 1) / vSteps.size();
+    }
+
+    LogPrintf("CDBCompactionManager::%s -- compacted %s (%d MiB) in %d steps, %dms\n", __func__, strName, nTotalSize >> 20, vSteps.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+void CDBCompactionManager::ThreadCompaction()
+{
+    while (true) {
+        std::pair<std::string, bool> entry;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty()) {
+                cond.wait(lock);
+            }
+            entry = queue.front();
+            queue.pop_front();
+            strCompacting = entry.first;
+            dProgress = 0;
+            fAbort = false;
+        }
+
+        uint64_t nBytesWritten = 0;
+        WithDBWrapper(entry.first, [&](CDBWrapper& db) {
+            nBytesWritten = db.GetBytesWritten();
+        });
+
+        bool fDone = CompactDB(entry.first, entry.second);
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fDone) {
+            mapLastCompactionTime[entry.first] = GetTime();
+            mapBytesWrittenAtCompaction[entry.first] = nBytesWritten;
+        }
+        strCompacting.clear();
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_DBCOMPACTION_H
+#define BITCOIN_DBCOMPACTION_H
+
+#include "validationinterface.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+//! -autocompactdb default
+static const bool DEFAULT_AUTO_COMPACT_DB = true;
+//! Minimum number of bytes written to a database before it is compacted automatically
+static const uint64_t DB_COMPACTION_MIN_BYTES_WRITTEN = 64 << 20;
+//! Minimum time (in seconds) between two automatic compactions of the same database
+static const int64_t DB_COMPACTION_MIN_INTERVAL = 60 * 60;
+//! Key prefixes larger than this are compacted in several steps, split by their second byte
+static const uint64_t DB_COMPACTION_STEP_SIZE = 16 << 20;
+
+/** LevelDB statistics of a single database, see CDBCompactionManager::GetStats */
+struct CDBStats
+{
+    struct Level {
+        int nLevel;
+        int nFiles;
+        double dSizeMB;
+    };
+
+    std::string strName;
+    //! Bytes written by the node since the database was opened
+    uint64_t nBytesWritten;
+    //! Megabytes written by LevelDB flushes and compactions since the database was opened
+    double dCompactionWrittenMB;
+    std::vector<Level> vLevels;
+    //! Time of the last completed manual compaction, 0 if none
+    int64_t nLastCompactionTime;
+
+    double GetSizeMB() const;
+    double GetWriteAmplification() const;
+};
+
+/**
+ * Schedules manual LevelDB compactions of all on-disk databases.
+ *
+ * LevelDB compacts on its own whenever a level grows too large, which shows up
+ * as latency spikes at random times. This manager compacts the database with
+ * the most writes since its last compaction right after a new tip was
+ * connected, while no DKG session is running, so that LevelDB has less left to
+ * do later. Compactions can also be requested with the compactdb RPC.
+ *
+ * Databases are compacted one key range of at most about
+ * DB_COMPACTION_STEP_SIZE bytes at a time on a dedicated thread, so progress
+ * can be reported and automatic compactions can be paused or aborted quickly.
+ * The database is only kept open for the duration of a single step.
+ */
+class CDBCompactionManager : public CValidationInterface
+{
+private:
+    mutable boost::mutex mutex;
+    boost::condition_variable cond;
+
+    //! Databases waiting to be compacted, and whether they were queued automatically
+    std::deque<std::pair<std::string, bool> > queue;
+    std::string strCompacting;
+    double dProgress;
+    std::atomic<bool> fAbort;
+
+    std::map<std::string, int64_t> mapLastCompactionTime;
+    std::map<std::string, uint64_t> mapBytesWrittenAtCompaction;
+
+    bool CompactDB(const std::string& strName, bool fAutomatic);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+
+public:
+    std::atomic<bool> fAutoCompact;
+
+    CDBCompactionManager() : dProgress(0), fAbort(false), fAutoCompact(DEFAULT_AUTO_COMPACT_DB) {}
+
+    /** Queue a database ("all" for every database), returns false if there is no such database */
+    bool Enqueue(const std::string& strName);
+    /** Abort the running compaction and clear the queue, returns false if nothing was running */
+    bool Abort();
+    /** Returns false if no compaction is running or queued */
+    bool GetProgress(std::string& strNameRet, double& dProgressRet, std::vector<std::string>& vQueuedRet) const;
+    std::vector<CDBStats> GetStats() const;
+
+    void ThreadCompaction();
+};
+
+extern CDBCompactionManager dbCompactionManager;
+
+#endif // BITCOIN_DBCOMPACTION_H
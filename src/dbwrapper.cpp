@@ -8,6 +8,7 @@
 #include "fs.h"
 #include "util.h"
 #include "random.h"
+#include "sync.h"
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -91,7 +92,14 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+//! Open on-disk databases, see ForEachDBWrapper
+static CWaitableCriticalSection cs_dbwrappers;
+static CConditionVariable condDBWrapperReleased;
+static std::set<CDBWrapper*> setDBWrappers;
+//! Number of ForEachDBWrapper/WithDBWrapper calls using each database (protected by cs_dbwrappers)
+static std::map<const CDBWrapper*, int> mapDBWrapperUsers;
+
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate) : nBytesWritten(0)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
@@ -140,10 +148,28 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    if (!fMemory) {
+        m_name = path.string();
+        const std::string strDataDir = GetDataDir().string() + "/";
+        if (m_name.compare(0, strDataDir.size(), strDataDir) == 0) {
+            m_name = m_name.substr(strDataDir.size());
+        }
+        boost::unique_lock<boost::mutex> lock(cs_dbwrappers);
+        setDBWrappers.insert(this);
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        // Nobody can start using this database anymore, wait for those who are
+        boost::unique_lock<boost::mutex> lock(cs_dbwrappers);
+        setDBWrappers.erase(this);
+        while (mapDBWrapperUsers.count(this)) {
+            condDBWrapperReleased.wait(lock);
+        }
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -160,6 +186,105 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    nBytesWritten += batch.SizeEstimate();
+    return true;
+}
+
+// Key range of nPrefix with a second byte in [nSubBegin, nSubEnd), strEnd is empty if it is open ended
+static void GetPrefixRange(unsigned char nPrefix, unsigned int nSubBegin, unsigned int nSubEnd, std::string& strBegin, std::string& strEnd)
+{
+    strBegin.assign(1, (char)nPrefix);
+    if (nSubBegin > 0) {
+        strBegin.push_back((char)nSubBegin);
+    }
+    if (nSubEnd < 256) {
+        strEnd.assign(1, (char)nPrefix);
+        strEnd.push_back((char)nSubEnd);
+    } else if (nPrefix < 0xff) {
+        strEnd.assign(1, (char)(nPrefix + 1));
+    } else {
+        strEnd.clear();
+    }
+}
+
+size_t CDBWrapper::EstimatePrefixSize(unsigned char nPrefix, unsigned int nSubBegin, unsigned int nSubEnd) const
+{
+    std::string strBegin, strEnd;
+    GetPrefixRange(nPrefix, nSubBegin, nSubEnd, strBegin, strEnd);
+    if (strEnd.empty()) {
+        // the range of the last prefix is open ended, use the largest possible key
+        strEnd.assign(DBWRAPPER_PREALLOC_KEY_SIZE, '\xff');
+    }
+    leveldb::Range range(strBegin, strEnd);
+    uint64_t size = 0;
+    pdb->GetApproximateSizes(&range, 1, &size);
+    return size;
+}
+
+void CDBWrapper::CompactPrefix(unsigned char nPrefix, unsigned int nSubBegin, unsigned int nSubEnd) const
+{
+    std::string strBegin, strEnd;
+    GetPrefixRange(nPrefix, nSubBegin, nSubEnd, strBegin, strEnd);
+    leveldb::Slice slBegin(strBegin), slEnd(strEnd);
+    pdb->CompactRange(&slBegin, strEnd.empty() ? nullptr : &slEnd);
+}
+
+bool CDBWrapper::GetProperty(const std::string& strProperty, std::string& strValue) const
+{
+    return pdb->GetProperty(strProperty, &strValue);
+}
+
+/**
+ * Databases in use by ForEachDBWrapper/WithDBWrapper. They are taken under
+ * cs_dbwrappers, but used without it; their destructor waits until they are
+ * released again.
+ */
+class CDBWrapperUsage
+{
+public:
+    std::vector<CDBWrapper*> vDBWrappers;
+
+    explicit CDBWrapperUsage(const std::string* pstrName)
+    {
+        boost::unique_lock<boost::mutex> lock(cs_dbwrappers);
+        for (CDBWrapper* pdbwrapper : setDBWrappers) {
+            if (!pstrName || pdbwrapper->GetName() == *pstrName) {
+                mapDBWrapperUsers[pdbwrapper]++;
+                vDBWrappers.push_back(pdbwrapper);
+                // names are unique
+                if (pstrName) break;
+            }
+        }
+    }
+
+    ~CDBWrapperUsage()
+    {
+        boost::unique_lock<boost::mutex> lock(cs_dbwrappers);
+        for (CDBWrapper* pdbwrapper : vDBWrappers) {
+            auto it = mapDBWrapperUsers.find(pdbwrapper);
+            if (--it->second == 0) {
+                mapDBWrapperUsers.erase(it);
+            }
+        }
+        condDBWrapperReleased.notify_all();
+    }
+};
+
+void ForEachDBWrapper(const std::function<void(CDBWrapper&)>& fn)
+{
+    CDBWrapperUsage usage(nullptr);
+    for (CDBWrapper* pdbwrapper : usage.vDBWrappers) {
+        fn(*pdbwrapper);
+    }
+}
+
+bool WithDBWrapper(const std::string& strName, const std::function<void(CDBWrapper&)>& fn)
+{
+    CDBWrapperUsage usage(&strName);
+    if (usage.vDBWrappers.empty()) {
+        return false;
+    }
+    fn(*usage.vDBWrappers[0]);
     return true;
 }
 
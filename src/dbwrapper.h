@@ -14,6 +14,8 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <atomic>
+#include <functional>
 #include <typeindex>
 
 #include <leveldb/db.h>
@@ -220,6 +222,12 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! name of the database, its path relative to the data directory
+    std::string m_name;
+
+    //! bytes written by WriteBatch since the database was opened
+    std::atomic<uint64_t> nBytesWritten;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -400,8 +408,31 @@ public:
         pdb->CompactRange(nullptr, nullptr);
     }
 
+    /**
+     * Approximate size on disk and compaction of all keys whose serialized
+     * form starts with the byte nPrefix, optionally only those whose second
+     * byte is in [nSubBegin, nSubEnd). Allows to compact a whole database
+     * in steps without knowing its key types.
+     */
+    size_t EstimatePrefixSize(unsigned char nPrefix, unsigned int nSubBegin = 0, unsigned int nSubEnd = 256) const;
+    void CompactPrefix(unsigned char nPrefix, unsigned int nSubBegin = 0, unsigned int nSubEnd = 256) const;
+
+    /** Read a LevelDB property like "leveldb.stats", see leveldb::DB::GetProperty */
+    bool GetProperty(const std::string& strProperty, std::string& strValue) const;
+
+    const std::string& GetName() const { return m_name; }
+    uint64_t GetBytesWritten() const { return nBytesWritten; }
 };
 
+/**
+ * Call fn for every open on-disk database. fn runs without holding the lock
+ * on the list of databases; a database which is closed meanwhile waits in its
+ * destructor until fn returned, so fn may use them from any thread.
+ */
+void ForEachDBWrapper(const std::function<void(CDBWrapper&)>& fn);
+/** Call fn for the open on-disk database named strName, returns false if there is none */
+bool WithDBWrapper(const std::string& strName, const std::function<void(CDBWrapper&)>& fn);
+
 template<typename CDBTransaction>
 class CDBTransactionIterator
 {
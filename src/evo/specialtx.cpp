@@ -5,6 +5,7 @@
 
 #include "chainparams.h"
 #include "clientversion.h"
+#include "compat/endian.h"
 #include "consensus/validation.h"
 #include "hash.h"
 #include "primitives/block.h"
@@ -13,6 +14,7 @@
 
 #include "cbtx.h"
 #include "deterministicmns.h"
+#include "evodb.h"
 #include "specialtx.h"
 
 #include "llmq/quorums_commitment.h"
@@ -87,6 +89,97 @@ bool UndoSpecialTx(const CTransaction& tx, const CBlockIndex* pindex)
     return false;
 }
 
+static const std::string DB_SPECIALTX_INDEX = "s_ti";
+
+static const uint16_t SPECIALTX_INDEX_TYPES[] = {
+    TRANSACTION_PROVIDER_REGISTER,
+    TRANSACTION_PROVIDER_UPDATE_SERVICE,
+    TRANSACTION_PROVIDER_UPDATE_REGISTRAR,
+    TRANSACTION_PROVIDER_UPDATE_REVOKE,
+    TRANSACTION_COINBASE,
+    TRANSACTION_QUORUM_COMMITMENT,
+};
+
+static std::tuple<std::string, uint16_t, uint32_t, uint32_t> BuildSpecialTxIndexKey(uint16_t nType, int nHeight, uint32_t nTxIndex)
+{
+    // height and index must be converted to big endian to make them comparable when serialized
+    return std::make_tuple(DB_SPECIALTX_INDEX, nType, htobe32((uint32_t)nHeight), htobe32(nTxIndex));
+}
+
+static void WriteSpecialTxIndex(const CBlock& block, const CBlockIndex* pindex)
+{
+    for (uint32_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.nVersion == 3 && tx.nType != TRANSACTION_NORMAL) {
+            evoDb->Write(BuildSpecialTxIndexKey(tx.nType, pindex->nHeight, i), tx.GetHash());
+        }
+    }
+}
+
+static void EraseSpecialTxIndex(const CBlock& block, const CBlockIndex* pindex)
+{
+    for (uint32_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.nVersion == 3 && tx.nType != TRANSACTION_NORMAL) {
+            evoDb->Erase(BuildSpecialTxIndexKey(tx.nType, pindex->nHeight, i));
+        }
+    }
+}
+
+std::vector<CSpecialTxIndexEntry> GetSpecialTxIndexEntries(int nType, int nStartHeight, int nEndHeight, size_t nSkip, size_t nCount)
+{
+    std::vector<CSpecialTxIndexEntry> ret;
+    if (nStartHeight < 0 || nEndHeight < nStartHeight || nCount == 0) {
+        return ret;
+    }
+
+    // The entries to return are among the first nSkip + nCount ones of each type
+    const size_t nMaxEntries = nSkip + nCount;
+
+    auto dbIt = evoDb->GetCurTransaction().NewIteratorUniquePtr();
+    for (uint16_t nIndexType : SPECIALTX_INDEX_TYPES) {
+        if (nType != -1 && nType != nIndexType) {
+            continue;
+        }
+
+        auto firstKey = BuildSpecialTxIndexKey(nIndexType, nStartHeight, 0);
+        dbIt->Seek(firstKey);
+
+        size_t nTypeEntries = 0;
+        while (dbIt->Valid() && nTypeEntries < nMaxEntries) {
+            decltype(firstKey) curKey;
+            if (!dbIt->GetKey(curKey) || std::get<0>(curKey) != DB_SPECIALTX_INDEX || std::get<1>(curKey) != nIndexType) {
+                break;
+            }
+            int nHeight = (int)be32toh(std::get<2>(curKey));
+            if (nHeight > nEndHeight) {
+                break;
+            }
+
+            CSpecialTxIndexEntry entry{nIndexType, nHeight, be32toh(std::get<3>(curKey)), uint256()};
+            if (!dbIt->GetValue(entry.txid)) {
+                break;
+            }
+            ret.emplace_back(entry);
+            nTypeEntries++;
+
+            dbIt->Next();
+        }
+    }
+
+    if (nType == -1) {
+        std::sort(ret.begin(), ret.end(), [](const CSpecialTxIndexEntry& a, const CSpecialTxIndexEntry& b) {
+            return std::make_pair(a.nHeight, a.nTxIndex) < std::make_pair(b.nHeight, b.nTxIndex);
+        });
+        if (ret.size() > nMaxEntries) {
+            ret.resize(nMaxEntries);
+        }
+    }
+
+    ret.erase(ret.begin(), ret.begin() + std::min(nSkip, ret.size()));
+    return ret;
+}
+
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots)
 {
     static int64_t nTimeLoop = 0;
@@ -130,6 +223,10 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
     int64_t nTime5 = GetTimeMicros(); nTimeMerkle += nTime5 - nTime4;
     LogPrint(BCLog::BENCHMARK, "        - CheckCbTxMerkleRoots: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeMerkle * 0.000001);
 
+    if (fSpecialTxIndex && !fJustCheck) {
+        WriteSpecialTxIndex(block, pindex);
+    }
+
     return true;
 }
 
@@ -150,6 +247,10 @@ bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
         return false;
     }
 
+    if (fSpecialTxIndex) {
+        EraseSpecialTxIndex(block, pindex);
+    }
+
     return true;
 }
 
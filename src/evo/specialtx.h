@@ -18,6 +18,20 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
+// Entry of the optional special tx index (-specialtxindex), which maps special tx type and height to txids
+struct CSpecialTxIndexEntry
+{
+    uint16_t nType;
+    int nHeight;
+    uint32_t nTxIndex; // position of the tx in its block
+    uint256 txid;
+};
+
+// Returns the indexed special txes of the given type (-1 for all types) mined between nStartHeight and
+// nEndHeight (inclusive), ordered by height and position in the block. The first nSkip of them are left
+// out and at most nCount are returned, the index is only read up to the last returned entry.
+std::vector<CSpecialTxIndexEntry> GetSpecialTxIndexEntries(int nType, int nStartHeight, int nEndHeight, size_t nSkip, size_t nCount);
+
 template <typename T>
 inline bool GetTxPayload(const std::vector<unsigned char>& payload, T& obj)
 {
@@ -4,6 +4,7 @@
 
 #include "governance-classes.h"
 #include "core_io.h"
+#include "evo/deterministicmns.h"
 #include "init.h"
 #include "pos/rewards.h"
 #include "utilstrencodings.h"
@@ -16,6 +17,11 @@
 // DECLARE GLOBAL VARIABLES FOR GOVERNANCE CLASSES
 CGovernanceTriggerManager triggerman;
 
+std::map<int, CSuperblockManager::CTriggerScan> CSuperblockManager::mapTriggerScans;
+
+// Upper bound for the number of remembered trigger scans
+static const size_t MAX_TRIGGER_SCANS = 16;
+
 // SPLIT UP STRING BY DELIMITER
 // http://www.boost.org/doc/libs/1_58_0/doc/html/boost/algorithm/split_idp202406848.html
 std::vector<std::string> SplitBy(const std::string& strCommand, const std::string& strDelimit)
@@ -121,6 +127,7 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
     pSuperblock->SetStatus(SEEN_OBJECT_IS_VALID);
 
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
+    CSuperblockManager::InvalidateCache();
 
     return true;
 }
@@ -216,43 +223,66 @@ std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers()
 }
 
 /**
-*   Is Superblock Triggered
+*   Invalidate Cache
 *
-*   - Does this block have a non-executed and actived trigger?
+*   - Forget all trigger scans, called whenever triggers or their votes change
 */
 
-bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
+void CSuperblockManager::InvalidateCache()
 {
-    LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- Start nBlockHeight = %d\n", nBlockHeight);
-    if (!CSuperblock::IsValidBlockHeight(nBlockHeight)) {
-        return false;
+    LOCK(governance.cs);
+    mapTriggerScans.clear();
+}
+
+/**
+*   Get Trigger Scan
+*
+*   - Scan the active triggers for this height once and remember the result
+*     until governance data or the chain tip changes
+*/
+
+const CSuperblockManager::CTriggerScan& CSuperblockManager::GetTriggerScan(int nBlockHeight)
+{
+    AssertLockHeld(governance.cs);
+
+    uint256 nTipHash = deterministicMNManager->GetListAtChainTip().GetBlockHash();
+    auto it = mapTriggerScans.find(nBlockHeight);
+    if (it != mapTriggerScans.end() && it->second.nTipHash == nTipHash) {
+        return it->second;
     }
 
-    LOCK(governance.cs);
+    // only a few superblock heights around the tip are ever asked for
+    if (mapTriggerScans.size() >= MAX_TRIGGER_SCANS) {
+        mapTriggerScans.clear();
+    }
+
+    CTriggerScan& scan = mapTriggerScans[nBlockHeight];
+    scan = CTriggerScan();
+    scan.nTipHash = nTipHash;
+
     // GET ALL ACTIVE TRIGGERS
     std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    int nYesCount = 0;
 
-    LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- vecTriggers.size() = %d\n", vecTriggers.size());
+    LogPrint(BCLog::GOBJECT, "CSuperblockManager::GetTriggerScan -- nBlockHeight = %d, vecTriggers.size() = %d\n", nBlockHeight, vecTriggers.size());
 
     for (const auto& pSuperblock : vecTriggers) {
         if (!pSuperblock) {
-            LogPrintf("CSuperblockManager::IsSuperblockTriggered -- Non-superblock found, continuing\n");
+            LogPrintf("CSuperblockManager::GetTriggerScan -- Non-superblock found, continuing\n");
             continue;
         }
 
         CGovernanceObject* pObj = pSuperblock->GetGovernanceObject();
 
         if (!pObj) {
-            LogPrintf("CSuperblockManager::IsSuperblockTriggered -- pObj == nullptr, continuing\n");
+            LogPrintf("CSuperblockManager::GetTriggerScan -- pObj == nullptr, continuing\n");
             continue;
         }
 
-        LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- data = %s\n", pObj->GetDataAsPlainString());
-
-        // note : 12.1 - is epoch calculation correct?
+        LogPrint(BCLog::GOBJECT, "CSuperblockManager::GetTriggerScan -- data = %s\n", pObj->GetDataAsPlainString());
 
         if (nBlockHeight != pSuperblock->GetBlockHeight()) {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- block height doesn't match nBlockHeight = %d, blockStart = %d, continuing\n",
+            LogPrint(BCLog::GOBJECT, "CSuperblockManager::GetTriggerScan -- block height doesn't match nBlockHeight = %d, blockStart = %d, continuing\n",
                 nBlockHeight,
                 pSuperblock->GetBlockHeight());
             continue;
@@ -263,48 +293,56 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
         pObj->UpdateSentinelVariables();
 
         if (pObj->IsSetCachedFunding()) {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- fCacheFunding = true, returning true\n");
-            return true;
+            LogPrint(BCLog::GOBJECT, "CSuperblockManager::GetTriggerScan -- fCacheFunding = true\n");
+            scan.fTriggered = true;
         } else {
-            LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- fCacheFunding = false, continuing\n");
+            LogPrint(BCLog::GOBJECT, "CSuperblockManager::GetTriggerScan -- fCacheFunding = false\n");
+        }
+
+        // DO WE HAVE A NEW WINNER?
+
+        int nTempYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
+        if (nTempYesCount > nYesCount) {
+            nYesCount = nTempYesCount;
+            scan.pBestSuperblock = pSuperblock;
         }
     }
 
-    return false;
+    return scan;
 }
 
+/**
+*   Is Superblock Triggered
+*
+*   - Does this block have a non-executed and actived trigger?
+*/
 
-bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int nBlockHeight)
+bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
 {
+    LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- Start nBlockHeight = %d\n", nBlockHeight);
     if (!CSuperblock::IsValidBlockHeight(nBlockHeight)) {
         return false;
     }
 
-    AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
-    int nYesCount = 0;
-
-    for (const auto& pSuperblock : vecTriggers) {
-        if (!pSuperblock || nBlockHeight != pSuperblock->GetBlockHeight()) {
-            continue;
-        }
+    LOCK(governance.cs);
+    return GetTriggerScan(nBlockHeight).fTriggered;
+}
 
-        CGovernanceObject* pObj = pSuperblock->GetGovernanceObject();
 
-        if (!pObj) {
-            continue;
-        }
-
-        // DO WE HAVE A NEW WINNER?
+bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int nBlockHeight)
+{
+    if (!CSuperblock::IsValidBlockHeight(nBlockHeight)) {
+        return false;
+    }
 
-        int nTempYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
-        if (nTempYesCount > nYesCount) {
-            nYesCount = nTempYesCount;
-            pSuperblockRet = pSuperblock;
-        }
+    AssertLockHeld(governance.cs);
+    const CTriggerScan& scan = GetTriggerScan(nBlockHeight);
+    if (!scan.pBestSuperblock) {
+        return false;
     }
 
-    return nYesCount > 0;
+    pSuperblockRet = scan.pBestSuperblock;
+    return true;
 }
 
 /**
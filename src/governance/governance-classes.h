@@ -56,10 +56,24 @@ public:
 class CSuperblockManager
 {
 private:
+    /**
+    *   Result of the trigger scan for one superblock height. Entries are dropped
+    *   whenever triggers or votes change and are only valid for the chain tip
+    *   they were computed at, as the funding threshold depends on the MN count.
+    */
+    struct CTriggerScan {
+        uint256 nTipHash;
+        bool fTriggered{false};
+        CSuperblock_sptr pBestSuperblock;
+    };
+    static std::map<int, CTriggerScan> mapTriggerScans; // protected by governance.cs
+
+    static const CTriggerScan& GetTriggerScan(int nBlockHeight);
     static bool GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int nBlockHeight);
 
 public:
     static bool IsSuperblockTriggered(int nBlockHeight);
+    static void InvalidateCache();
 
     static bool GetSuperblockPayments(int nBlockHeight, std::vector<CTxOut>& voutSuperblockRet);
     static void ExecuteBestSuperblock(int nBlockHeight);
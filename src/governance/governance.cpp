@@ -269,6 +269,7 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
             fRemove = true;
         } else if (govobj.ProcessVote(nullptr, vote, exception, connman)) {
             vote.Relay(connman);
+            CSuperblockManager::InvalidateCache();
             fRemove = true;
         }
         if (fRemove) {
@@ -446,6 +447,9 @@ void CGovernanceManager::UpdateCachesAndClean()
         }
     }
 
+    // triggers, their votes or the objects behind them might have changed
+    CSuperblockManager::InvalidateCache();
+
     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
 }
 
@@ -839,6 +843,9 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
     }
 
     bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    if (fOk) {
+        CSuperblockManager::InvalidateCache();
+    }
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
@@ -1292,6 +1299,8 @@ void CGovernanceManager::RemoveInvalidVotes()
                 cmmapOrphanVotes.Erase(voteHash);
                 setRequestedVotes.erase(voteHash);
             }
+            // Trigger scans at the new tip may already count the removed votes
+            CSuperblockManager::InvalidateCache();
         }
     }
 
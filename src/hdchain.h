@@ -111,6 +111,7 @@ public:
     uint256 GetID() const { return id; }
 
     uint256 GetSeedHash();
+    void DeriveChangeExtKey(uint32_t nAccountIndex, bool fInternal, CExtKey& extKeyRet);
     void DeriveChildExtKey(uint32_t nAccountIndex, bool fInternal, uint32_t nChildIndex, CExtKey& extKeyRet);
 
     void AddAccount();
@@ -19,6 +19,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "dbcompaction.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
@@ -468,6 +469,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-autocompactdb", strprintf(_("Compact the databases right after new blocks, outside of DKG sessions, instead of leaving it all to LevelDB (default: %u)"), DEFAULT_AUTO_COMPACT_DB));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -509,6 +511,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-specialtxindex", strprintf(_("Maintain an index of special transactions by type and height, used by the getspecialtxesbyheight rpc call (default: %u)"), DEFAULT_SPECIALTXINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -591,6 +594,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)", DEFAULT_ANCESTOR_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
+        strUsage += HelpMessageOpt("-limitclustercount=<n>", strprintf("Do not accept transactions which would join an in-mempool cluster of more than <n> transactions (default: %u)", DEFAULT_CLUSTER_LIMIT));
         strUsage += HelpMessageOpt("-vbparams=<deployment>:<start>:<end>(:<window>:<threshold>)", "Use given start/end times for specified version bits deployment (regtest-only). Specifying window and threshold is optional.");
         strUsage += HelpMessageOpt("-watchquorums=<n>", strprintf("Watch and validate quorum communication (default: %u)", llmq::DEFAULT_WATCH_QUORUMS));
     }
@@ -1228,6 +1232,7 @@ bool AppInitParameterInteraction()
     if (ratio != 0) {
         mempool.setSanityCheck(1.0 / ratio);
     }
+    mempool.setClusterLimit(gArgs.GetArg("-limitclustercount", DEFAULT_CLUSTER_LIMIT));
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
@@ -1746,6 +1751,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     pdsNotificationInterface = new CDSNotificationInterface(connman);
     RegisterValidationInterface(pdsNotificationInterface);
 
+    dbCompactionManager.fAutoCompact = gArgs.GetBoolArg("-autocompactdb", DEFAULT_AUTO_COMPACT_DB);
+    RegisterValidationInterface(&dbCompactionManager);
+    threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()> >, "dbcompact", std::function<void()>(std::bind(&CDBCompactionManager::ThreadCompaction, &dbCompactionManager))));
+
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
     uint64_t nMaxOutboundTimeframe = MAX_UPLOAD_TIMEFRAME;
 
@@ -1882,6 +1891,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Check for changed -specialtxindex state
+                if (fSpecialTxIndex != gArgs.GetBoolArg("-specialtxindex", DEFAULT_SPECIALTXINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -specialtxindex");
+                    break;
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1935,6 +1950,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                uiInterface.InitMessage(_("Loading UTXO set statistics..."));
+                if (!LoadUTXOStats()) {
+                    strLoadError = _("Error loading UTXO set statistics");
+                    break;
+                }
+
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
                     // LoadChainTip sets chainActive based on pcoinsTip's best block
@@ -2186,6 +2207,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     scheduler.scheduleEvery(boost::bind(&CMasternodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000);
 
+    // apply queued fee estimator events off the block connection and transaction acceptance paths
+    scheduler.scheduleEvery(boost::bind(&CBlockPolicyEstimator::FlushQueue, boost::ref(::feeEstimator)), 1 * 1000);
+
+    if (fAddressIndex || fSpentIndex) {
+        // apply queued mempool address/spent index updates off the transaction acceptance path
+        scheduler.scheduleEvery(boost::bind(&CTxMemPool::FlushIndexQueue, boost::ref(mempool)), 1 * 1000);
+    }
+
     if (fMasternodeMode) {
         scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1 * 1000);
 #ifdef ENABLE_WALLET
@@ -2237,7 +2266,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             scheduler.scheduleEvery(boost::bind(&CStakingManager::DoMaintenance, boost::ref(stakingManager), boost::ref(*g_connman)), 5 * 1000);
         }
         if (rewardManager->fEnableRewardManager) {
-            scheduler.scheduleEvery(boost::bind(&CRewardManager::DoMaintenance, boost::ref(rewardManager), boost::ref(*g_connman)), 3 * 60 * 1000);
+            threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()> >, "autocombine", std::function<void()>(std::bind(&CRewardManager::ThreadAutoCombine, rewardManager))));
         }
     }
 #endif // ENABLE_WALLET
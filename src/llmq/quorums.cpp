@@ -184,9 +184,18 @@ void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const
 
     // don't remove connections for the currently in-progress DKG round
     int curDkgHeight = pindexNew->nHeight - (pindexNew->nHeight % params.dkgInterval);
-    auto curDkgBlock = pindexNew->GetAncestor(curDkgHeight)->GetBlockHash();
+    auto pindexCurDkg = pindexNew->GetAncestor(curDkgHeight);
+    auto curDkgBlock = pindexCurDkg->GetBlockHash();
     connmanQuorumsToDelete.erase(curDkgBlock);
 
+    // The members of the in-progress DKG round are known as soon as its quorum block is connected. Start connecting
+    // to them right away instead of waiting for the DKG session to be initialized, so that the connections are
+    // verified before the contribution phase starts. The DKG session handler won't add them again
+    if (lastDKGConnectionsQuorum[llmqType] != curDkgBlock && !g_connman->HasMasternodeQuorumNodes(llmqType, curDkgBlock)) {
+        EnsureDKGConnections(llmqType, pindexCurDkg);
+        lastDKGConnectionsQuorum[llmqType] = curDkgBlock;
+    }
+
     for (auto& quorum : lastQuorums) {
         if (!quorum->IsMember(myProTxHash) && !gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) {
             continue;
@@ -228,6 +237,32 @@ void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const
     }
 }
 
+void CQuorumManager::EnsureDKGConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
+{
+    auto myProTxHash = activeMasternodeInfo.proTxHash;
+    auto members = CLLMQUtils::GetAllQuorumMembers(llmqType, pindexQuorum);
+    bool isMember = std::find_if(members.begin(), members.end(), [&](const CDeterministicMNCPtr& dmn) { return dmn->proTxHash == myProTxHash; }) != members.end();
+
+    if (!isMember && !gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) {
+        return;
+    }
+
+    std::set<uint256> connections;
+    if (isMember) {
+        connections = CLLMQUtils::GetQuorumConnections(llmqType, pindexQuorum, myProTxHash);
+    } else {
+        auto cindexes = CLLMQUtils::CalcDeterministicWatchConnections(llmqType, pindexQuorum, members.size(), 1);
+        for (auto idx : cindexes) {
+            connections.emplace(members[idx]->proTxHash);
+        }
+    }
+    if (!connections.empty()) {
+        LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- adding %d masternodes quorum connections for DKG of quorum %s\n", __func__,
+                 connections.size(), pindexQuorum->GetBlockHash().ToString());
+        g_connman->AddMasternodeQuorumNodes(llmqType, pindexQuorum->GetBlockHash(), connections);
+    }
+}
+
 bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum, const uint256& minedBlockHash, std::shared_ptr<CQuorum>& quorum) const
 {
     assert(pindexQuorum);
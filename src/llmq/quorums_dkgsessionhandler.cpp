@@ -168,6 +168,12 @@ std::pair<QuorumPhase, uint256> CDKGSessionHandler::GetPhaseAndQuorumHash() cons
     return std::make_pair(phase, quorumHash);
 }
 
+bool CDKGSessionHandler::IsSessionActive() const
+{
+    QuorumPhase curPhase = GetPhaseAndQuorumHash().first;
+    return curPhase >= QuorumPhase_Initialized && curPhase < QuorumPhase_Idle;
+}
+
 class AbortPhaseException : public std::exception {
 };
 
@@ -500,7 +506,10 @@ void CDKGSessionHandler::HandleDKGRound()
         return changed;
     });
 
-    if (curSession->AreWeMember() || gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) {
+    // CQuorumManager::EnsureQuorumConnections usually added the connections already when the quorum block was
+    // connected, only add them here if that was missed, e.g. because the node started in the middle of the DKG
+    if ((curSession->AreWeMember() || gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) &&
+        !g_connman->HasMasternodeQuorumNodes(params.type, curQuorumHash)) {
         std::set<uint256> connections;
         if (curSession->AreWeMember()) {
             connections = CLLMQUtils::GetQuorumConnections(params.type, pindexQuorum, curSession->myProTxHash);
@@ -125,6 +125,8 @@ public:
     void UpdatedBlockTip(const CBlockIndex *pindexNew);
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
+    bool IsSessionActive() const;
+
 private:
     bool InitNewQuorum(const CBlockIndex* pindexQuorum);
 
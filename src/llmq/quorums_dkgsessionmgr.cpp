@@ -66,6 +66,16 @@ void CDKGSessionManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fIni
     }
 }
 
+bool CDKGSessionManager::IsDKGActive() const
+{
+    for (const auto& qt : dkgSessionHandlers) {
+        if (qt.second.IsSessionActive()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void CDKGSessionManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     if (!sporkManager.IsSporkActive(SPORK_18_QUORUM_DKG_ENABLED))
@@ -54,6 +54,8 @@ public:
     void StopMessageHandlerPool();
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, bool fInitialDownload);
+    // Returns true while any DKG session is between its initialization and finalization
+    bool IsDKGActive() const;
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
     bool AlreadyHave(const CInv& inv) const;
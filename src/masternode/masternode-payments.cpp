@@ -349,8 +349,7 @@ bool CMasternodePayments::GetBlockTxOuts(int nBlockHeight, CBlockReward blockRew
         LOCK(cs_main);
         pindex = chainActive[nBlockHeight - 1];
     }
-    uint256 proTxHash;
-    auto dmnPayee = deterministicMNManager->GetListForBlock(pindex).GetMNPayee();
+    auto dmnPayee = GetPayeeForBlock(pindex);
     if (!dmnPayee) {
         return false;
     }
@@ -373,6 +372,25 @@ bool CMasternodePayments::GetBlockTxOuts(int nBlockHeight, CBlockReward blockRew
     return true;
 }
 
+CDeterministicMNCPtr CMasternodePayments::GetPayeeForBlock(const CBlockIndex* pindexPrev) const
+{
+    // keyed by block hash, so entries stay valid across reorgs
+    const uint256& blockHash = pindexPrev->GetBlockHash();
+    CDeterministicMNCPtr dmnPayee;
+    {
+        LOCK(cs);
+        if (payeeCache.get(blockHash, dmnPayee)) {
+            return dmnPayee;
+        }
+    }
+
+    dmnPayee = deterministicMNManager->GetListForBlock(pindexPrev).GetMNPayee();
+
+    LOCK(cs);
+    payeeCache.insert(blockHash, dmnPayee);
+    return dmnPayee;
+}
+
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 blocks of votes
 bool CMasternodePayments::IsScheduled(const CDeterministicMNCPtr& dmnIn, int nNotBlockHeight) const
@@ -11,11 +11,18 @@
 #include "net_processing.h"
 #include "utilstrencodings.h"
 
+#include "saltedhasher.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
+
 #include "evo/deterministicmns.h"
 
 class CMasternodePayments;
 class CBlockReward;
 
+//! Number of blocks for which the expected masternode payee is remembered
+static const size_t MASTERNODE_PAYEE_CACHE_SIZE = 64;
+
 /// TODO: all 4 functions do not belong here really, they should be refactored/moved somewhere (main.cpp ?)
 bool IsBlockValueValid(const CBlock& block, const int nBlockHeight, const CBlockReward& blockReward, const CAmount coinstakeValueIn, std::string& strErrorRet);
 bool IsBlockPayeeValid(const CTransactionRef txNewMiner, const CTransactionRef txNewStaker, int nBlockHeight, CBlockReward blockReward);
@@ -31,6 +38,13 @@ extern CMasternodePayments mnpayments;
 
 class CMasternodePayments
 {
+private:
+    mutable CCriticalSection cs;
+    // payee of the block following the key block, computing it walks the whole MN list
+    mutable unordered_lru_cache<uint256, CDeterministicMNCPtr, StaticSaltedHasher, MASTERNODE_PAYEE_CACHE_SIZE> payeeCache;
+
+    CDeterministicMNCPtr GetPayeeForBlock(const CBlockIndex* pindexPrev) const;
+
 public:
     bool GetBlockTxOuts(int nBlockHeight, CBlockReward blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet) const;
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight, CBlockReward blockReward) const;
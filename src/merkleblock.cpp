@@ -10,8 +10,10 @@
 #include "consensus/consensus.h"
 #include "utilstrencodings.h"
 
-CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
+CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter, const CBloomBlockElements* pvElements)
 {
+    assert(!pvElements || pvElements->size() == block.vtx.size());
+
     header = block.GetBlockHeader();
 
     std::vector<bool> vMatch;
@@ -35,7 +37,7 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
         const uint256& hash = tx.GetHash();
         bool isAllowedType = tx.nVersion != 3 || allowedTxTypes.count(tx.nType) != 0;
 
-        if (isAllowedType && filter.IsRelevantAndUpdate(tx))
+        if (isAllowedType && (pvElements ? filter.IsRelevantAndUpdate(*(*pvElements)[i]) : filter.IsRelevantAndUpdate(tx)))
         {
             vMatch.push_back(true);
             vMatchedTxn.push_back(std::make_pair(i, hash));
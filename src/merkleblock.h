@@ -140,8 +140,10 @@ public:
      * Create from a CBlock, filtering transactions according to filter
      * Note that this will call IsRelevantAndUpdate on the filter for each transaction,
      * thus the filter will likely be modified.
+     * pvElements optionally are the filter elements of the block's transactions shared
+     * with other filters, see GetBloomBlockElements.
      */
-    CMerkleBlock(const CBlock& block, CBloomFilter& filter);
+    CMerkleBlock(const CBlock& block, CBloomFilter& filter, const CBloomBlockElements* pvElements = nullptr);
 
     // Create from a CBlock, matching the txids in the set
     CMerkleBlock(const CBlock& block, const std::set<uint256>& txids);
@@ -2112,9 +2112,10 @@ void CConnman::ThreadOpenMasternodeConnections()
 
         int64_t nANow = GetAdjustedTime();
 
-        // NOTE: Process only one pending masternode at a time
+        // Dial up to MAX_PARALLEL_MASTERNODE_DIALS pending masternodes at once, so that all connections of a new
+        // quorum are established early in the DKG instead of one per second
 
-        CService addr;
+        std::vector<CService> toConnect;
         { // don't hold lock while calling OpenMasternodeConnection as cs_main is locked deep inside
             LOCK2(cs_vNodes, cs_vPendingMasternodes);
 
@@ -2151,18 +2152,55 @@ void CConnman::ThreadOpenMasternodeConnections()
             }
 
             std::random_shuffle(pending.begin(), pending.end());
-            addr = pending.front();
+            std::set<CService> picked;
+            for (const auto& addr2 : pending) {
+                if (picked.size() >= MAX_PARALLEL_MASTERNODE_DIALS) {
+                    break;
+                }
+                if (picked.emplace(addr2).second) {
+                    toConnect.emplace_back(addr2);
+                }
+            }
         }
 
-        OpenMasternodeConnection(CAddress(addr, NODE_NETWORK));
-        // should be in the list now if connection was opened
-        ForNode(addr, CConnman::AllNodes, [&](CNode* pnode) {
-            if (pnode->fDisconnect) {
-                return false;
+        // one grant per dial, the first one was already acquired above. Don't wait for more slots
+        std::deque<CSemaphoreGrant> grants;
+        grants.emplace_back();
+        grant.MoveTo(grants.back());
+        while (grants.size() < toConnect.size()) {
+            grants.emplace_back(*semMasternodeOutbound, true);
+            if (!grants.back()) {
+                grants.pop_back();
+                break;
             }
-            grant.MoveTo(pnode->grantMasternodeOutbound);
-            return true;
-        });
+        }
+
+        auto dial = [this](const CService& addr, CSemaphoreGrant& dialGrant) {
+            OpenMasternodeConnection(CAddress(addr, NODE_NETWORK));
+            // should be in the list now if connection was opened
+            ForNode(addr, CConnman::AllNodes, [&](CNode* pnode) {
+                if (pnode->fDisconnect) {
+                    return false;
+                }
+                dialGrant.MoveTo(pnode->grantMasternodeOutbound);
+                return true;
+            });
+        };
+
+        if (grants.size() == 1) {
+            dial(toConnect.front(), grants.front());
+            continue;
+        }
+
+        std::vector<std::thread> dialThreads;
+        for (size_t i = 0; i < grants.size(); i++) {
+            const CService& addr = toConnect[i];
+            CSemaphoreGrant& dialGrant = grants[i];
+            dialThreads.emplace_back(&TraceThread<std::function<void()> >, "mndial", std::function<void()>([&dial, &addr, &dialGrant]() { dial(addr, dialGrant); }));
+        }
+        for (auto& t : dialThreads) {
+            t.join();
+        }
     }
 }
 
@@ -1203,11 +1203,13 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
         {
             bool sendMerkleBlock = false;
             CMerkleBlock merkleBlock;
+            // All filtered peers requesting this block share the extracted elements
+            std::shared_ptr<const CBloomBlockElements> pvElements = GetBloomBlockElements(inv.hash, pblock->vtx);
             {
                 LOCK(pfrom->cs_filter);
                 if (pfrom->pfilter) {
                     sendMerkleBlock = true;
-                    merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter);
+                    merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter, pvElements.get());
                 }
             }
             if (sendMerkleBlock) {
@@ -3836,7 +3838,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     CInv inv(nInvType, hash);
                     pto->setInventoryTxToSend.erase(hash);
                     if (pto->pfilter) {
-                        if (!pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                        if (!pto->pfilter->IsRelevantAndUpdate(*GetBloomTxElements(txinfo.tx))) continue;
                     }
                     pto->filterInventoryKnown.insert(hash);
 
@@ -3897,7 +3899,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     if (!txinfo.tx) {
                         continue;
                     }
-                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*GetBloomTxElements(txinfo.tx))) continue;
                     // Send
                     int nInvType = MSG_TX;
                     if (CPrivateSend::GetDSTX(hash)) {
@@ -515,9 +515,17 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
 // tracked. Txs that were part of a block have already been removed in
 // processBlockTx to ensure they are never double tracked, but it is
 // of no harm to try to remove them again.
-bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
+void CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
 {
-    LOCK(cs_feeEstimator);
+    QueuedEvent event(QueuedEvent::TX_REMOVED);
+    event.tx.hash = hash;
+    event.fFlag = inBlock;
+    QueueEvent(std::move(event));
+}
+
+bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock) const
+{
+    AssertLockHeld(cs_feeEstimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -530,6 +538,62 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
     }
 }
 
+CBlockPolicyEstimator::TxEventInfo::TxEventInfo(const CTxMemPoolEntry& entry) :
+    hash(entry.GetTx().GetHash()),
+    nHeight(entry.GetHeight()),
+    // Feerates are stored and reported as BTC-per-kb:
+    feeRate(entry.GetFee(), entry.GetTxSize())
+{
+}
+
+void CBlockPolicyEstimator::QueueEvent(QueuedEvent&& event)
+{
+    size_t nQueued;
+    {
+        LOCK(cs_queue);
+        vQueue.emplace_back(std::move(event));
+        nQueued = vQueue.size();
+    }
+    if (nQueued >= MAX_FEE_ESTIMATOR_QUEUE) {
+        // Nothing flushed the queue for a long time, don't let it grow without bounds
+        TRY_LOCK(cs_feeEstimator, lockEstimator);
+        if (lockEstimator) {
+            ApplyQueue();
+        }
+    }
+}
+
+void CBlockPolicyEstimator::ApplyQueue() const
+{
+    AssertLockHeld(cs_feeEstimator);
+
+    std::vector<QueuedEvent> queue;
+    {
+        LOCK(cs_queue);
+        queue.swap(vQueue);
+    }
+
+    for (const auto& event : queue) {
+        switch (event.type) {
+        case QueuedEvent::TX_ADDED:
+            _processTransaction(event.tx, event.fFlag);
+            break;
+        case QueuedEvent::TX_REMOVED:
+            _removeTx(event.tx.hash, event.fFlag);
+            break;
+        case QueuedEvent::BLOCK:
+            _processBlock(event.nBlockHeight, event.blockTxs);
+            break;
+        }
+    }
+}
+
+void CBlockPolicyEstimator::FlushQueue() const
+{
+    LOCK(cs_feeEstimator);
+    ApplyQueue();
+}
+
 CBlockPolicyEstimator::CBlockPolicyEstimator()
     : nBestSeenHeight(0), firstRecordedHeight(0), historicalFirst(0), historicalBest(0), trackedTxs(0), untrackedTxs(0)
 {
@@ -557,9 +621,17 @@ CBlockPolicyEstimator::~CBlockPolicyEstimator()
 
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
 {
-    LOCK(cs_feeEstimator);
-    unsigned int txHeight = entry.GetHeight();
-    uint256 hash = entry.GetTx().GetHash();
+    QueuedEvent event(QueuedEvent::TX_ADDED);
+    event.tx = TxEventInfo(entry);
+    event.fFlag = validFeeEstimate;
+    QueueEvent(std::move(event));
+}
+
+void CBlockPolicyEstimator::_processTransaction(const TxEventInfo& tx, bool validFeeEstimate) const
+{
+    AssertLockHeld(cs_feeEstimator);
+    unsigned int txHeight = tx.nHeight;
+    const uint256& hash = tx.hash;
     if (mapMemPoolTxs.count(hash)) {
         LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error mempool tx %s already being tracked\n", hash.ToString());
         return;
@@ -581,8 +653,7 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     }
     trackedTxs++;
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
+    const CFeeRate& feeRate = tx.feeRate;
 
     mapMemPoolTxs[hash].blockHeight = txHeight;
     unsigned int bucketIndex = feeStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
@@ -593,9 +664,9 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex3);
 }
 
-bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
+bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const TxEventInfo& tx) const
 {
-    if (!removeTx(entry->GetTx().GetHash(), true)) {
+    if (!_removeTx(tx.hash, true)) {
         // This transaction wasn't being tracked for fee estimation
         return false;
     }
@@ -603,7 +674,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
-    int blocksToConfirm = nBlockHeight - entry->GetHeight();
+    int blocksToConfirm = nBlockHeight - tx.nHeight;
     if (blocksToConfirm <= 0) {
         // This can't happen because we don't process transactions from a block with a height
         // lower than our greatest seen height
@@ -611,8 +682,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
+    const CFeeRate& feeRate = tx.feeRate;
 
     feeStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     shortStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
@@ -623,7 +693,18 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
 void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
                                          std::vector<const CTxMemPoolEntry*>& entries)
 {
-    LOCK(cs_feeEstimator);
+    QueuedEvent event(QueuedEvent::BLOCK);
+    event.nBlockHeight = nBlockHeight;
+    event.blockTxs.reserve(entries.size());
+    for (const auto& entry : entries) {
+        event.blockTxs.emplace_back(*entry);
+    }
+    QueueEvent(std::move(event));
+}
+
+void CBlockPolicyEstimator::_processBlock(unsigned int nBlockHeight, const std::vector<TxEventInfo>& txs) const
+{
+    AssertLockHeld(cs_feeEstimator);
     if (nBlockHeight <= nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random
         // they don't affect the estimate.
@@ -650,8 +731,8 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
-    for (const auto& entry : entries) {
-        if (processBlockTx(nBlockHeight, entry))
+    for (const auto& tx : txs) {
+        if (processBlockTx(nBlockHeight, tx))
             countedTxs++;
     }
 
@@ -662,7 +743,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy estimates updated by %u of %u block txs, since last block %u of %u tracked, mempool map size %u, max target %u from %s\n",
-             countedTxs, entries.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
+             countedTxs, txs.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
              MaxUsableEstimate(), HistoricalBlockSpan() > BlockSpan() ? "historical" : "current");
 
     trackedTxs = 0;
@@ -702,6 +783,7 @@ CFeeRate CBlockPolicyEstimator::estimateRawFee(int confTarget, double successThr
     }
 
     LOCK(cs_feeEstimator);
+    FlushQueue();
     // Return failure if trying to analyze a target we're not tracking
     if (confTarget <= 0 || (unsigned int)confTarget > stats->GetMaxConfirms())
         return CFeeRate(0);
@@ -828,6 +910,7 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
 CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
 {
     LOCK(cs_feeEstimator);
+    FlushQueue();
 
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
@@ -908,6 +991,7 @@ bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
 {
     try {
         LOCK(cs_feeEstimator);
+        FlushQueue();
         fileout << 140100; // version required to read: 5.0.99 or later
         fileout << CLIENT_VERSION; // version that wrote the file
         fileout << nBestSeenHeight;
@@ -933,6 +1017,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
 {
     try {
         LOCK(cs_feeEstimator);
+        ApplyQueue();
         int nVersionRequired, nVersionThatWrote;
         unsigned int nFileBestSeenHeight, nFileHistoricalFirst, nFileHistoricalBest;
         filein >> nVersionRequired >> nVersionThatWrote;
@@ -1019,8 +1104,9 @@ void CBlockPolicyEstimator::FlushUnconfirmed(CTxMemPool& pool) {
     std::vector<uint256> txids;
     pool.queryHashes(txids);
     LOCK(cs_feeEstimator);
+    ApplyQueue();
     for (auto& txid : txids) {
-        removeTx(txid, false);
+        _removeTx(txid, false);
     }
     int64_t endclear = GetTimeMicros();
     LogPrint(BCLog::ESTIMATEFEE, "Recorded %u unconfirmed txs from mempool in %ld micros\n",txids.size(), endclear - startclear);
@@ -130,6 +130,9 @@ struct FeeCalculation
     int returnedTarget = 0;
 };
 
+/** Number of queued events after which they are applied by the caller queueing them, in case no flush runs */
+static const unsigned int MAX_FEE_ESTIMATOR_QUEUE = 50000;
+
 /**
  *  We want to be able to estimate feerates that are needed on tx's to be included in
  * a certain number of blocks.  Every time a block is added to the best chain, this class records
@@ -199,7 +202,10 @@ public:
     void processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate);
 
     /** Remove a transaction from the mempool tracking stats*/
-    bool removeTx(uint256 hash, bool inBlock);
+    void removeTx(uint256 hash, bool inBlock);
+
+    /** Apply the queued block and mempool events to the stats */
+    void FlushQueue() const;
 
     /** DEPRECATED. Return a feerate estimate */
     CFeeRate estimateFee(int confTarget) const;
@@ -230,8 +236,12 @@ public:
     unsigned int HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
 private:
-    unsigned int nBestSeenHeight;
-    unsigned int firstRecordedHeight;
+    /**
+     * The state updated by queued events is mutable: const estimates apply the queue first,
+     * see ApplyQueue. All of it is protected by cs_feeEstimator.
+     */
+    mutable unsigned int nBestSeenHeight;
+    mutable unsigned int firstRecordedHeight;
     unsigned int historicalFirst;
     unsigned int historicalBest;
 
@@ -243,23 +253,57 @@ private:
     };
 
     // map of txids to information about that transaction
-    std::map<uint256, TxStatsInfo> mapMemPoolTxs;
+    mutable std::map<uint256, TxStatsInfo> mapMemPoolTxs;
 
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats* feeStats;
     TxConfirmStats* shortStats;
     TxConfirmStats* longStats;
 
-    unsigned int trackedTxs;
-    unsigned int untrackedTxs;
+    mutable unsigned int trackedTxs;
+    mutable unsigned int untrackedTxs;
 
     std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
 
     mutable CCriticalSection cs_feeEstimator;
 
+    /**
+     * Block and mempool events are not processed while the block is connected or the transaction is accepted,
+     * they are queued instead and applied in order by FlushQueue(), which runs periodically and before every
+     * estimate, so estimates are the same as if the events had been processed right away.
+     */
+    struct TxEventInfo
+    {
+        uint256 hash;
+        unsigned int nHeight{0};
+        CFeeRate feeRate;
+
+        TxEventInfo() {}
+        explicit TxEventInfo(const CTxMemPoolEntry& entry);
+    };
+    struct QueuedEvent
+    {
+        enum Type { TX_ADDED, TX_REMOVED, BLOCK } type;
+        bool fFlag{false}; //!< validFeeEstimate for TX_ADDED, inBlock for TX_REMOVED
+        unsigned int nBlockHeight{0};
+        TxEventInfo tx;
+        std::vector<TxEventInfo> blockTxs;
+
+        explicit QueuedEvent(Type _type) : type(_type) {}
+    };
+    mutable CCriticalSection cs_queue;
+    mutable std::vector<QueuedEvent> vQueue; // protected by cs_queue
+
+    void QueueEvent(QueuedEvent&& event);
+    void ApplyQueue() const;
+
+    void _processBlock(unsigned int nBlockHeight, const std::vector<TxEventInfo>& txs) const;
+    void _processTransaction(const TxEventInfo& tx, bool validFeeEstimate) const;
+    bool _removeTx(const uint256& hash, bool inBlock) const;
+
     /** Process a transaction confirmed in a block*/
-    bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry);
+    bool processBlockTx(unsigned int nBlockHeight, const TxEventInfo& tx) const;
 
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const;
@@ -17,9 +17,175 @@
 #include <univalue.h>
 
 #include <QMessageBox>
+#include <QSet>
 #include <QTimer>
 #include <QtGui/QClipboard>
 
+/** Column of the next payment height, it is the only column which changes for unchanged masternodes */
+static const int COLUMN_NEXT_PAYMENT = 5;
+/** Hidden column holding the proTxHash */
+static const int COLUMN_PROTX_HASH = 11;
+
+/** Formats rows of the masternode list on the worker thread */
+class MasternodeListWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    void setModels(ClientModel* _clientModel, WalletModel* _walletModel)
+    {
+        LOCK(cs);
+        clientModel = _clientModel;
+        walletModel = _walletModel;
+    }
+
+public Q_SLOTS:
+    void update(bool fFull);
+
+Q_SIGNALS:
+    void updateReady(const MasternodeListUpdate& update);
+
+private:
+    CCriticalSection cs;
+    ClientModel* clientModel{nullptr};
+    WalletModel* walletModel{nullptr};
+
+    // Only accessed on the worker thread
+    CDeterministicMNList lastList;
+    bool fHaveLastList{false};
+};
+
+void MasternodeListWorker::update(bool fFull)
+{
+    ClientModel* _clientModel;
+    WalletModel* _walletModel;
+    {
+        LOCK(cs);
+        _clientModel = clientModel;
+        _walletModel = walletModel;
+    }
+
+    if (!_clientModel || ShutdownRequested()) {
+        return;
+    }
+
+    auto mnList = _clientModel->getMasternodeList();
+
+    MasternodeListUpdate update;
+    update.fFull = fFull || !fHaveLastList;
+
+    // Only masternodes which were added or changed since the last update are formatted again
+    std::vector<CDeterministicMNCPtr> vecChanged;
+    if (update.fFull) {
+        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+            vecChanged.emplace_back(dmn);
+        });
+    } else {
+        auto diff = lastList.BuildDiff(mnList);
+        vecChanged = diff.addedMNs;
+        for (const auto& p : diff.updatedMNs) {
+            auto dmn = mnList.GetMNByInternalId(p.first);
+            if (dmn) {
+                vecChanged.emplace_back(dmn);
+            }
+        }
+        for (const auto& id : diff.removedMns) {
+            auto dmn = lastList.GetMNByInternalId(id);
+            if (dmn) {
+                update.removed.append(QString::fromStdString(dmn->proTxHash.ToString()));
+            }
+        }
+    }
+
+    std::map<uint256, CTxDestination> mapCollateralDests;
+
+    {
+        // Get all UTXOs for each MN collateral in one go so that we can reduce locking overhead for cs_main
+        // We also do this outside of the below formatting loop to reduce cs_main locking time to a minimum
+        LOCK(cs_main);
+        for (const auto& dmn : vecChanged) {
+            CTxDestination collateralDest;
+            Coin coin;
+            if (GetUTXOCoin(dmn->collateralOutpoint, coin) && ExtractDestination(coin.out.scriptPubKey, collateralDest)) {
+                mapCollateralDests.emplace(dmn->proTxHash, collateralDest);
+            }
+        }
+    }
+
+    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
+    for (size_t i = 0; i < projectedPayees.size(); i++) {
+        const auto& dmn = projectedPayees[i];
+        update.nextPayments.insert(QString::fromStdString(dmn->proTxHash.ToString()), mnList.GetHeight() + (int)i + 1);
+    }
+
+    std::set<COutPoint> setOutpts;
+    if (_walletModel) {
+        std::vector<COutPoint> vOutpts;
+        _walletModel->listProTxCoins(vOutpts);
+        for (const auto& outpt : vOutpts) {
+            setOutpts.emplace(outpt);
+        }
+    }
+
+    for (const auto& dmn : vecChanged) {
+        MasternodeListRow row;
+        row.strProTxHash = QString::fromStdString(dmn->proTxHash.ToString());
+        row.fMine = _walletModel && (setOutpts.count(dmn->collateralOutpoint) ||
+            _walletModel->IsSpendable(dmn->pdmnState->keyIDOwner) ||
+            _walletModel->IsSpendable(dmn->pdmnState->keyIDVoting) ||
+            _walletModel->IsSpendable(dmn->pdmnState->scriptPayout) ||
+            _walletModel->IsSpendable(dmn->pdmnState->scriptOperatorPayout));
+
+        CTxDestination payeeDest;
+        QString payeeStr = MasternodeList::tr("UNKNOWN");
+        if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
+            payeeStr = QString::fromStdString(CBitcoinAddress(payeeDest).ToString());
+        }
+
+        QString operatorRewardStr = MasternodeList::tr("NONE");
+        if (dmn->nOperatorReward) {
+            operatorRewardStr = QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
+
+            if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
+                CTxDestination operatorDest;
+                if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
+                    operatorRewardStr += MasternodeList::tr("to %1").arg(QString::fromStdString(CBitcoinAddress(operatorDest).ToString()));
+                } else {
+                    operatorRewardStr += MasternodeList::tr("to UNKNOWN");
+                }
+            } else {
+                operatorRewardStr += MasternodeList::tr("but not claimed");
+            }
+        }
+
+        QString collateralStr = MasternodeList::tr("UNKNOWN");
+        auto collateralDestIt = mapCollateralDests.find(dmn->proTxHash);
+        if (collateralDestIt != mapCollateralDests.end()) {
+            collateralStr = QString::fromStdString(CBitcoinAddress(collateralDestIt->second).ToString());
+        }
+
+        // Address, Status, PoSe Score, Registered, Last Paid, Next Payment, Payee, Operator Reward, Collateral, Owner, Voting
+        row.columns << QString::fromStdString(dmn->pdmnState->addr.ToString())
+                    << (mnList.IsMNValid(dmn) ? MasternodeList::tr("ENABLED") : (mnList.IsMNPoSeBanned(dmn) ? MasternodeList::tr("POSE_BANNED") : MasternodeList::tr("UNKNOWN")))
+                    << QString::number(dmn->pdmnState->nPoSePenalty)
+                    << QString::number(dmn->pdmnState->nRegisteredHeight)
+                    << QString::number(dmn->pdmnState->nLastPaidHeight)
+                    << QString() // next payment, filled in from nextPayments
+                    << payeeStr
+                    << operatorRewardStr
+                    << collateralStr
+                    << QString::fromStdString(CBitcoinAddress(dmn->pdmnState->keyIDOwner).ToString())
+                    << QString::fromStdString(CBitcoinAddress(dmn->pdmnState->keyIDVoting).ToString())
+                    << row.strProTxHash;
+        update.rows.append(row);
+    }
+
+    lastList = mnList;
+    fHaveLastList = true;
+
+    Q_EMIT updateReady(update);
+}
+
 int GetOffsetFromUtc()
 {
 #if QT_VERSION < 0x050200
@@ -39,7 +205,8 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
     fFilterUpdatedDIP3(true),
     nTimeFilterUpdatedDIP3(0),
     nTimeUpdatedDIP3(0),
-    mnListChanged(true)
+    mnListChanged(true),
+    fFullUpdateDIP3(true)
 {
     ui->setupUi(this);
 
@@ -69,8 +236,8 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
 
     // dummy column for proTxHash
     // TODO use a proper table model for the MN list
-    ui->tableWidgetMasternodesDIP3->insertColumn(11);
-    ui->tableWidgetMasternodesDIP3->setColumnHidden(11, true);
+    ui->tableWidgetMasternodesDIP3->insertColumn(COLUMN_PROTX_HASH);
+    ui->tableWidgetMasternodesDIP3->setColumnHidden(COLUMN_PROTX_HASH, true);
 
     ui->tableWidgetMasternodesDIP3->setContextMenuPolicy(Qt::CustomContextMenu);
 
@@ -84,6 +251,16 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
     connect(copyProTxHashAction, SIGNAL(triggered()), this, SLOT(copyProTxHash_clicked()));
     connect(copyCollateralOutpointAction, SIGNAL(triggered()), this, SLOT(copyCollateralOutpoint_clicked()));
 
+    qRegisterMetaType<MasternodeListUpdate>("MasternodeListUpdate");
+
+    worker = new MasternodeListWorker();
+    worker->moveToThread(&thread);
+    connect(this, SIGNAL(updateRequest(bool)), worker, SLOT(update(bool)));
+    connect(worker, SIGNAL(updateReady(MasternodeListUpdate)), this, SLOT(applyDIP3ListUpdate(MasternodeListUpdate)));
+    connect(this, SIGNAL(stopWorker()), &thread, SLOT(quit()));
+    connect(&thread, SIGNAL(finished()), worker, SLOT(deleteLater()), Qt::DirectConnection);
+    thread.start();
+
     timer = new QTimer(this);
     connect(timer, SIGNAL(timeout()), this, SLOT(updateDIP3ListScheduled()));
     timer->start(1000);
@@ -91,12 +268,15 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
 
 MasternodeList::~MasternodeList()
 {
+    Q_EMIT stopWorker();
+    thread.wait();
     delete ui;
 }
 
 void MasternodeList::setClientModel(ClientModel* model)
 {
     this->clientModel = model;
+    worker->setModels(clientModel, walletModel);
     if (model) {
         // try to update list when masternode count changes
         connect(clientModel, SIGNAL(masternodeListChanged()), this, SLOT(handleMasternodeListChanged()));
@@ -106,6 +286,7 @@ void MasternodeList::setClientModel(ClientModel* model)
 void MasternodeList::setWalletModel(WalletModel* model)
 {
     this->walletModel = model;
+    worker->setModels(clientModel, walletModel);
 }
 
 void MasternodeList::showContextMenuDIP3(const QPoint& point)
@@ -136,7 +317,11 @@ void MasternodeList::updateDIP3ListScheduled()
         ui->countLabelDIP3->setText(QString::fromStdString(strprintf("Please wait... %d", nSecondsToWait)));
 
         if (nSecondsToWait <= 0) {
-            updateDIP3List();
+            if (fFullUpdateDIP3) {
+                updateDIP3List();
+            } else {
+                filterDIP3List();
+            }
             fFilterUpdatedDIP3 = false;
         }
     } else if (mnListChanged) {
@@ -156,138 +341,93 @@ void MasternodeList::updateDIP3List()
         return;
     }
 
-    auto mnList = clientModel->getMasternodeList();
-    std::map<uint256, CTxDestination> mapCollateralDests;
-
-    {
-        // Get all UTXOs for each MN collateral in one go so that we can reduce locking overhead for cs_main
-        // We also do this outside of the below Qt list update loop to reduce cs_main locking time to a minimum
-        LOCK(cs_main);
-        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-            CTxDestination collateralDest;
-            Coin coin;
-            if (GetUTXOCoin(dmn->collateralOutpoint, coin) && ExtractDestination(coin.out.scriptPubKey, collateralDest)) {
-                mapCollateralDests.emplace(dmn->proTxHash, collateralDest);
-            }
-        });
-    }
+    // Formatting happens on the worker thread, the result arrives in applyDIP3ListUpdate
+    ui->countLabelDIP3->setText("Updating...");
+    nTimeUpdatedDIP3 = GetTime();
+    Q_EMIT updateRequest(fFullUpdateDIP3);
+    fFullUpdateDIP3 = false;
+}
 
+void MasternodeList::applyDIP3ListUpdate(const MasternodeListUpdate& update)
+{
     LOCK(cs_dip3list);
 
-    QString strToFilter;
-    ui->countLabelDIP3->setText("Updating...");
-    ui->tableWidgetMasternodesDIP3->setSortingEnabled(false);
-    ui->tableWidgetMasternodesDIP3->clearContents();
-    ui->tableWidgetMasternodesDIP3->setRowCount(0);
-
-    nTimeUpdatedDIP3 = GetTime();
+    QTableWidget* table = ui->tableWidgetMasternodesDIP3;
+    table->setSortingEnabled(false);
+    if (update.fFull) {
+        table->clearContents();
+        table->setRowCount(0);
+    }
 
-    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
-    std::map<uint256, int> nextPayments;
-    for (size_t i = 0; i < projectedPayees.size(); i++) {
-        const auto& dmn = projectedPayees[i];
-        nextPayments.emplace(dmn->proTxHash, mnList.GetHeight() + (int)i + 1);
+    QHash<QString, const MasternodeListRow*> mapChanged;
+    for (const auto& row : update.rows) {
+        mapChanged.insert(row.strProTxHash, &row);
     }
+    QSet<QString> setRemoved = QSet<QString>::fromList(update.removed);
 
-    std::set<COutPoint> setOutpts;
-    if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-        std::vector<COutPoint> vOutpts;
-        walletModel->listProTxCoins(vOutpts);
-        for (const auto& outpt : vOutpts) {
-            setOutpts.emplace(outpt);
+    auto setRow = [&](int nRow, const MasternodeListRow& row) {
+        for (int i = 0; i < row.columns.size(); i++) {
+            if (i == COLUMN_NEXT_PAYMENT) continue;
+            table->item(nRow, i)->setText(row.columns[i]);
         }
+        table->item(nRow, COLUMN_PROTX_HASH)->setData(Qt::UserRole, row.fMine);
+    };
+    auto nextPaymentStr = [&](const QString& strProTxHash) {
+        auto it = update.nextPayments.find(strProTxHash);
+        return it != update.nextPayments.end() ? QString::number(it.value()) : tr("UNKNOWN");
+    };
+
+    // Walk the existing rows once, removing and updating in place
+    for (int nRow = table->rowCount() - 1; nRow >= 0; nRow--) {
+        QString strProTxHash = table->item(nRow, COLUMN_PROTX_HASH)->text();
+        if (setRemoved.contains(strProTxHash)) {
+            table->removeRow(nRow);
+            continue;
+        }
+        auto it = mapChanged.find(strProTxHash);
+        if (it != mapChanged.end()) {
+            setRow(nRow, *it.value());
+            mapChanged.erase(it);
+        }
+        table->item(nRow, COLUMN_NEXT_PAYMENT)->setText(nextPaymentStr(strProTxHash));
     }
 
-    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-        if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-            bool fMyMasternode = setOutpts.count(dmn->collateralOutpoint) ||
-                walletModel->IsSpendable(dmn->pdmnState->keyIDOwner) ||
-                walletModel->IsSpendable(dmn->pdmnState->keyIDVoting) ||
-                walletModel->IsSpendable(dmn->pdmnState->scriptPayout) ||
-                walletModel->IsSpendable(dmn->pdmnState->scriptOperatorPayout);
-            if (!fMyMasternode) return;
+    // Whatever is left was added
+    for (const MasternodeListRow* row : mapChanged) {
+        int nRow = table->rowCount();
+        table->insertRow(nRow);
+        for (int i = 0; i < row->columns.size(); i++) {
+            table->setItem(nRow, i, new QTableWidgetItem());
         }
-        // populate list
-        // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
-        QTableWidgetItem* addressItem = new QTableWidgetItem(QString::fromStdString(dmn->pdmnState->addr.ToString()));
-        QTableWidgetItem* statusItem = new QTableWidgetItem(mnList.IsMNValid(dmn) ? tr("ENABLED") : (mnList.IsMNPoSeBanned(dmn) ? tr("POSE_BANNED") : tr("UNKNOWN")));
-        QTableWidgetItem* PoSeScoreItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nPoSePenalty));
-        QTableWidgetItem* registeredItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nRegisteredHeight));
-        QTableWidgetItem* lastPaidItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nLastPaidHeight));
-        QTableWidgetItem* nextPaymentItem = new QTableWidgetItem(nextPayments.count(dmn->proTxHash) ? QString::number(nextPayments[dmn->proTxHash]) : tr("UNKNOWN"));
+        setRow(nRow, *row);
+        table->item(nRow, COLUMN_NEXT_PAYMENT)->setText(nextPaymentStr(row->strProTxHash));
+    }
 
-        CTxDestination payeeDest;
-        QString payeeStr = tr("UNKNOWN");
-        if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
-            payeeStr = QString::fromStdString(CBitcoinAddress(payeeDest).ToString());
-        }
-        QTableWidgetItem* payeeItem = new QTableWidgetItem(payeeStr);
+    table->setSortingEnabled(true);
+    filterDIP3List();
+}
 
-        QString operatorRewardStr = tr("NONE");
-        if (dmn->nOperatorReward) {
-            operatorRewardStr = QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
+void MasternodeList::filterDIP3List()
+{
+    LOCK(cs_dip3list);
 
-            if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
-                CTxDestination operatorDest;
-                if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
-                    operatorRewardStr += tr("to %1").arg(QString::fromStdString(CBitcoinAddress(operatorDest).ToString()));
-                } else {
-                    operatorRewardStr += tr("to UNKNOWN");
-                }
-            } else {
-                operatorRewardStr += tr("but not claimed");
+    QTableWidget* table = ui->tableWidgetMasternodesDIP3;
+    bool fMyMasternodesOnly = walletModel && ui->checkBoxMyMasternodesOnly->isChecked();
+    int nVisible = 0;
+    for (int nRow = 0; nRow < table->rowCount(); nRow++) {
+        bool fHidden = fMyMasternodesOnly && !table->item(nRow, COLUMN_PROTX_HASH)->data(Qt::UserRole).toBool();
+        if (!fHidden && strCurrentFilterDIP3 != "") {
+            QStringList columns;
+            for (int i = 0; i < table->columnCount(); i++) {
+                columns << table->item(nRow, i)->text();
             }
+            fHidden = !columns.join(" ").contains(strCurrentFilterDIP3);
         }
-        QTableWidgetItem* operatorRewardItem = new QTableWidgetItem(operatorRewardStr);
-
-        QString collateralStr = tr("UNKNOWN");
-        auto collateralDestIt = mapCollateralDests.find(dmn->proTxHash);
-        if (collateralDestIt != mapCollateralDests.end()) {
-            collateralStr = QString::fromStdString(CBitcoinAddress(collateralDestIt->second).ToString());
-        }
-        QTableWidgetItem* collateralItem = new QTableWidgetItem(collateralStr);
-
-        QString ownerStr = QString::fromStdString(CBitcoinAddress(dmn->pdmnState->keyIDOwner).ToString());
-        QTableWidgetItem* ownerItem = new QTableWidgetItem(ownerStr);
-
-        QString votingStr = QString::fromStdString(CBitcoinAddress(dmn->pdmnState->keyIDVoting).ToString());
-        QTableWidgetItem* votingItem = new QTableWidgetItem(votingStr);
-
-        QTableWidgetItem* proTxHashItem = new QTableWidgetItem(QString::fromStdString(dmn->proTxHash.ToString()));
-
-        if (strCurrentFilterDIP3 != "") {
-            strToFilter = addressItem->text() + " " +
-                          statusItem->text() + " " +
-                          PoSeScoreItem->text() + " " +
-                          registeredItem->text() + " " +
-                          lastPaidItem->text() + " " +
-                          nextPaymentItem->text() + " " +
-                          payeeItem->text() + " " +
-                          operatorRewardItem->text() + " " +
-                          collateralItem->text() + " " +
-                          ownerItem->text() + " " +
-                          votingItem->text() + " " +
-                          proTxHashItem->text();
-            if (!strToFilter.contains(strCurrentFilterDIP3)) return;
-        }
+        table->setRowHidden(nRow, fHidden);
+        if (!fHidden) nVisible++;
+    }
 
-        ui->tableWidgetMasternodesDIP3->insertRow(0);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 0, addressItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 1, statusItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 2, PoSeScoreItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 3, registeredItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 4, lastPaidItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 5, nextPaymentItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 6, payeeItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 7, operatorRewardItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 8, collateralItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 9, ownerItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 10, votingItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 11, proTxHashItem);
-    });
-
-    ui->countLabelDIP3->setText(QString::number(ui->tableWidgetMasternodesDIP3->rowCount()));
-    ui->tableWidgetMasternodesDIP3->setSortingEnabled(true);
+    ui->countLabelDIP3->setText(QString::number(nVisible));
 }
 
 void MasternodeList::on_filterLineEditDIP3_textChanged(const QString& strFilterIn)
@@ -300,9 +440,10 @@ void MasternodeList::on_filterLineEditDIP3_textChanged(const QString& strFilterI
 
 void MasternodeList::on_checkBoxMyMasternodesOnly_stateChanged(int state)
 {
-    // no cooldown
+    // no cooldown, refresh which masternodes belong to the wallet
     nTimeFilterUpdatedDIP3 = GetTime() - MASTERNODELIST_FILTER_COOLDOWN_SECONDS;
     fFilterUpdatedDIP3 = true;
+    fFullUpdateDIP3 = true;
 }
 
 CDeterministicMNCPtr MasternodeList::GetSelectedDIP3MN()
@@ -322,7 +463,7 @@ CDeterministicMNCPtr MasternodeList::GetSelectedDIP3MN()
 
         QModelIndex index = selected.at(0);
         int nSelectedRow = index.row();
-        strProTxHash = ui->tableWidgetMasternodesDIP3->item(nSelectedRow, 11)->text().toStdString();
+        strProTxHash = ui->tableWidgetMasternodesDIP3->item(nSelectedRow, COLUMN_PROTX_HASH)->text().toStdString();
     }
 
     uint256 proTxHash;
@@ -368,3 +509,5 @@ void MasternodeList::copyCollateralOutpoint_clicked()
 
     QApplication::clipboard()->setText(QString::fromStdString(dmn->collateralOutpoint.ToStringShort()));
 }
+
+#include "masternodelist.moc"
@@ -8,7 +8,12 @@
 
 #include "evo/deterministicmns.h"
 
+#include <QHash>
+#include <QList>
 #include <QMenu>
+#include <QMetaType>
+#include <QStringList>
+#include <QThread>
 #include <QTimer>
 #include <QWidget>
 
@@ -21,8 +26,29 @@ class MasternodeList;
 }
 
 class ClientModel;
+class MasternodeListWorker;
 class WalletModel;
 
+/** Formatted table row of one masternode */
+struct MasternodeListRow {
+    QString strProTxHash;
+    QStringList columns; // all columns except the next payment
+    bool fMine{false};
+};
+
+/**
+ * Changes between the previously formatted masternode list and the current one.
+ * Only added and changed masternodes are formatted, the next payment height
+ * changes with every block and is sent for all masternodes.
+ */
+struct MasternodeListUpdate {
+    bool fFull{false}; // rows replace the whole table
+    QList<MasternodeListRow> rows;
+    QStringList removed;
+    QHash<QString, int> nextPayments;
+};
+Q_DECLARE_METATYPE(MasternodeListUpdate)
+
 QT_BEGIN_NAMESPACE
 class QModelIndex;
 QT_END_NAMESPACE
@@ -56,13 +82,21 @@ private:
     QString strCurrentFilterDIP3;
 
     bool mnListChanged;
+    bool fFullUpdateDIP3;
+
+    // Formats the list off the GUI thread
+    MasternodeListWorker* worker;
+    QThread thread;
 
     CDeterministicMNCPtr GetSelectedDIP3MN();
 
     void updateDIP3List();
+    void filterDIP3List();
 
 Q_SIGNALS:
     void doubleClicked(const QModelIndex&);
+    void updateRequest(bool fFull);
+    void stopWorker();
 
 private Q_SLOTS:
     void showContextMenuDIP3(const QPoint&);
@@ -75,5 +109,6 @@ private Q_SLOTS:
 
     void handleMasternodeListChanged();
     void updateDIP3ListScheduled();
+    void applyDIP3ListUpdate(const MasternodeListUpdate& update);
 };
 #endif // MASTERNODELIST_H
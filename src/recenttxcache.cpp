@@ -0,0 +1,86 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "recenttxcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+#include "primitives/block.h"
+
+CRecentTxCache::CRecentTxCache(size_t nMaxBlocksIn, size_t nMaxUsageIn) :
+    nMaxBlocks(nMaxBlocksIn),
+    nMaxUsage(nMaxUsageIn)
+{
+}
+
+void CRecentTxCache::EraseBlockTxs(const BlockEntry& entry)
+{
+    for (const auto& tx : entry.vtx) {
+        auto it = mapTxs.find(tx->GetHash());
+        // a duplicate txid may point to a newer block
+        if (it != mapTxs.end() && it->second.second == entry.hashBlock) {
+            mapTxs.erase(it);
+        }
+    }
+    nTxUsage -= entry.nTxUsage;
+}
+
+void CRecentTxCache::AddBlock(const CBlock& block, const uint256& hashBlock)
+{
+    if (nMaxBlocks == 0) {
+        return;
+    }
+
+    BlockEntry entry{hashBlock, block.vtx, 0};
+    for (const auto& tx : entry.vtx) {
+        entry.nTxUsage += RecursiveDynamicUsage(tx);
+        mapTxs[tx->GetHash()] = std::make_pair(tx, hashBlock);
+    }
+    nTxUsage += entry.nTxUsage;
+    blocks.emplace_back(std::move(entry));
+
+    while (!blocks.empty() && (blocks.size() > nMaxBlocks || DynamicMemoryUsage() > nMaxUsage)) {
+        EraseBlockTxs(blocks.front());
+        blocks.pop_front();
+    }
+}
+
+void CRecentTxCache::RemoveBlock(const uint256& hashBlock)
+{
+    // disconnected blocks are usually the newest one
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+        if (it->hashBlock == hashBlock) {
+            EraseBlockTxs(*it);
+            blocks.erase(std::next(it).base());
+            return;
+        }
+    }
+}
+
+bool CRecentTxCache::Get(const uint256& txid, CTransactionRef& txOut, uint256& hashBlock) const
+{
+    auto it = mapTxs.find(txid);
+    if (it == mapTxs.end()) {
+        return false;
+    }
+    txOut = it->second.first;
+    hashBlock = it->second.second;
+    return true;
+}
+
+void CRecentTxCache::Clear()
+{
+    blocks.clear();
+    mapTxs.clear();
+    nTxUsage = 0;
+}
+
+size_t CRecentTxCache::DynamicMemoryUsage() const
+{
+    size_t nVtxUsage = 0;
+    for (const auto& entry : blocks) {
+        nVtxUsage += memusage::DynamicUsage(entry.vtx);
+    }
+    return nTxUsage + nVtxUsage + memusage::DynamicUsage(mapTxs);
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RECENTTXCACHE_H
+#define BITCOIN_RECENTTXCACHE_H
+
+#include "primitives/transaction.h"
+#include "saltedhasher.h"
+#include "uint256.h"
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class CBlock;
+
+/**
+ * Transactions of the most recently connected blocks.
+ *
+ * Lets GetTransaction return transactions which just left the mempool without
+ * a txindex lookup and a block file read. The cache is bounded by a number of
+ * blocks and by its memory usage, the oldest block is evicted first.
+ * Not thread safe, callers must synchronize access.
+ */
+class CRecentTxCache
+{
+private:
+    struct BlockEntry
+    {
+        uint256 hashBlock;
+        std::vector<CTransactionRef> vtx;
+        size_t nTxUsage;
+    };
+
+    const size_t nMaxBlocks;
+    const size_t nMaxUsage;
+
+    std::deque<BlockEntry> blocks; //!< oldest block first
+    std::unordered_map<uint256, std::pair<CTransactionRef, uint256>, StaticSaltedHasher> mapTxs; //!< txid -> (tx, block hash)
+    size_t nTxUsage{0};
+
+    void EraseBlockTxs(const BlockEntry& entry);
+
+public:
+    CRecentTxCache(size_t nMaxBlocksIn, size_t nMaxUsageIn);
+
+    void AddBlock(const CBlock& block, const uint256& hashBlock);
+    void RemoveBlock(const uint256& hashBlock);
+    bool Get(const uint256& txid, CTransactionRef& txOut, uint256& hashBlock) const;
+    void Clear();
+
+    size_t BlockCount() const { return blocks.size(); }
+    size_t DynamicMemoryUsage() const;
+};
+
+#endif // BITCOIN_RECENTTXCACHE_H
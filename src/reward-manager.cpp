@@ -7,7 +7,10 @@
 #include "init.h"
 #include "masternode/masternode-sync.h"
 #include "policy/policy.h"
+#include "random.h"
+#include "ui_interface.h"
 #include "validation.h"
+#include "wallet/coincontrol.h"
 #include "wallet/wallet.h"
 
 // fix windows build
@@ -16,7 +19,29 @@
 std::shared_ptr<CRewardManager> rewardManager;
 
 CRewardManager::CRewardManager() :
-        fEnableRewardManager(false), fEnableAutoCombineRewards(false), nAutoCombineAmountThreshold(0), nAutoCombineNThreshold(10) {
+        fSmallOutputsInitialized(false), fEnableRewardManager(false), fEnableAutoCombineRewards(false), nAutoCombineAmountThreshold(0), nAutoCombineNThreshold(10) {
+}
+
+CRewardManager::~CRewardManager() {
+    connNotifyTransactionChanged.disconnect();
+}
+
+void CRewardManager::BindWallet(CWallet * const pwalletIn) {
+    connNotifyTransactionChanged.disconnect();
+    pwallet = pwalletIn;
+    {
+        LOCK(cs);
+        mapSmallOutputs.clear();
+        mapSmallOutputAddress.clear();
+        fSmallOutputsInitialized = false;
+    }
+    if (pwallet) {
+        // Called with cs_wallet held, so only remember the transaction here
+        connNotifyTransactionChanged = pwallet->NotifyTransactionChanged.connect([this](CWallet*, const uint256& hash, ChangeType) {
+            LOCK(cs_changedTxs);
+            setChangedTxs.insert(hash);
+        });
+    }
 }
 
 bool CRewardManager::IsReady() {
@@ -43,134 +68,265 @@ bool CRewardManager::IsCombining()
 
 void CRewardManager::AutoCombineSettings(bool fEnable, CAmount nAutoCombineAmountThresholdIn) {
     LOCK(cs);
+    if (nAutoCombineAmountThreshold != nAutoCombineAmountThresholdIn) {
+        // The buckets depend on the threshold, rebuild them on the next cycle
+        fSmallOutputsInitialized = false;
+    }
     fEnableAutoCombineRewards = fEnable;
     nAutoCombineAmountThreshold = nAutoCombineAmountThresholdIn;
 }
 
-// TODO: replace with pwallet->FilterCoins()
-std::map<CBitcoinAddress, std::vector<COutput> > CRewardManager::AvailableCoinsByAddress(bool fConfirmed, CAmount maxCoinValue) {
-    std::vector<COutput> vCoins;
-    pwallet->AvailableCoins(vCoins, fConfirmed);
-
-    std::map<CBitcoinAddress, std::vector<COutput> > mapCoins;
-    for (COutput out : vCoins) {
-        if (maxCoinValue > 0 && out.tx->tx->vout[out.i].nValue > maxCoinValue)
-            continue;
-
-        CTxDestination address;
-        if (!ExtractDestination(out.tx->tx->vout[out.i].scriptPubKey, address))
-            continue;
+void CRewardManager::AddSmallOutput(const COutPoint& outpoint, const CBitcoinAddress& address, CAmount nValue) {
+    AssertLockHeld(cs);
+    RemoveSmallOutput(outpoint);
+    mapSmallOutputs[address][outpoint] = nValue;
+    mapSmallOutputAddress.emplace(outpoint, address);
+}
 
-        mapCoins[CBitcoinAddress(address)].push_back(out);
+void CRewardManager::RemoveSmallOutput(const COutPoint& outpoint) {
+    AssertLockHeld(cs);
+    auto it = mapSmallOutputAddress.find(outpoint);
+    if (it == mapSmallOutputAddress.end())
+        return;
+    auto bucketIt = mapSmallOutputs.find(it->second);
+    if (bucketIt != mapSmallOutputs.end()) {
+        bucketIt->second.erase(outpoint);
+        if (bucketIt->second.empty())
+            mapSmallOutputs.erase(bucketIt);
     }
+    mapSmallOutputAddress.erase(it);
+}
 
-    return mapCoins;
+void CRewardManager::UpdateSmallOutput(const CWalletTx& wtx, unsigned int n, CAmount nMaxValue) {
+    AssertLockHeld(cs);
+    AssertLockHeld(pwallet->cs_wallet);
+    const COutPoint outpoint(wtx.GetHash(), n);
+    const CTxOut& txout = wtx.tx->vout[n];
+    CTxDestination address;
+    if (txout.nValue > nMaxValue || pwallet->IsSpent(outpoint.hash, n) || wtx.GetDepthInMainChain() < 0 ||
+            !(pwallet->IsMine(txout) & ISMINE_SPENDABLE) || !ExtractDestination(txout.scriptPubKey, address)) {
+        RemoveSmallOutput(outpoint);
+        return;
+    }
+    AddSmallOutput(outpoint, CBitcoinAddress(address), txout.nValue);
 }
 
-void CRewardManager::AutoCombineRewards() {
-    std::map<CBitcoinAddress, std::vector<COutput> > mapCoinsByAddress = AvailableCoinsByAddress(true, nAutoCombineAmountThreshold * COIN);
+bool CRewardManager::IsCombinable(const CWalletTx& wtx, unsigned int n) const {
+    AssertLockHeld(pwallet->cs_wallet);
+    if (n >= wtx.tx->vout.size() || pwallet->IsSpent(wtx.GetHash(), n) || pwallet->IsLockedCoin(wtx.GetHash(), n))
+        return false;
+    if ((wtx.IsCoinBase() || wtx.IsCoinStake()) && wtx.GetBlocksToMaturity() > 0)
+        return false;
+    int nDepth = wtx.GetDepthInMainChain();
+    if (nDepth < 0 || (nDepth == 0 && !wtx.IsTrusted()))
+        return false;
+    return (pwallet->IsMine(wtx.tx->vout[n]) & ISMINE_SPENDABLE) != ISMINE_NO;
+}
 
-    //coins are sectioned by address. This combination code only wants to combine inputs that belong to the same address
-    for (std::map<CBitcoinAddress, std::vector<COutput> >::iterator it = mapCoinsByAddress.begin(); it != mapCoinsByAddress.end(); it++) {
-        bool maxSize = false;
-        std::vector<COutput> vRewardCoins;
-        std::vector<COutput> vCoins(it->second);
+void CRewardManager::UpdateSmallOutputs() {
+    const CAmount nMaxValue = nAutoCombineAmountThreshold * COIN;
 
-        std::sort(vCoins.begin(), vCoins.end(), [](const COutput& a, const COutput& b) {
-            return a.GetValue() < b.GetValue();
-        });
+    bool fInitialized;
+    {
+        LOCK(cs);
+        fInitialized = fSmallOutputsInitialized;
+    }
+    if (!fInitialized) {
+        // Only scan the whole wallet once, later updates come from wallet notifications
+        {
+            LOCK(cs_changedTxs);
+            setChangedTxs.clear();
+        }
+        // Same criteria as the incremental updates: immature and unconfirmed outputs are kept
+        // in the buckets too, IsCombinable() decides whether they can be spent when planning
+        LOCK2(cs_main, pwallet->cs_wallet);
+        LOCK(cs);
+        mapSmallOutputs.clear();
+        mapSmallOutputAddress.clear();
+        for (const auto& entry : pwallet->mapWallet) {
+            const CWalletTx& wtx = entry.second;
+            for (unsigned int n = 0; n < wtx.tx->vout.size(); n++) {
+                UpdateSmallOutput(wtx, n, nMaxValue);
+            }
+        }
+        fSmallOutputsInitialized = true;
+        return;
+    }
 
-        // We don't want the tx to be refused for being too large
-        // we use 50 bytes as a base tx size (2 output: 2*34 + overhead: 10 -> 90 to be certain)
-        unsigned int txSizeEstimate = 90;
+    std::vector<uint256> vChangedTxs;
+    {
+        LOCK(cs_changedTxs);
+        vChangedTxs.assign(setChangedTxs.begin(), setChangedTxs.end());
+        setChangedTxs.clear();
+    }
 
-        //find masternode rewards that need to be combined
-        CCoinControl coinControl;
-        CAmount nTotalRewardsValue = 0;
-        for (const COutput& out : vCoins) {
-            if (!out.fSpendable)
+    // Take cs_wallet in short batches so the staker isn't starved
+    for (size_t nStart = 0; nStart < vChangedTxs.size(); nStart += AUTOCOMBINE_UPDATE_BATCH_SIZE) {
+        LOCK2(cs_main, pwallet->cs_wallet);
+        LOCK(cs);
+        size_t nEnd = std::min(vChangedTxs.size(), nStart + AUTOCOMBINE_UPDATE_BATCH_SIZE);
+        for (size_t i = nStart; i < nEnd; i++) {
+            const CWalletTx* pwtx = pwallet->GetWalletTx(vChangedTxs[i]);
+            if (!pwtx)
                 continue;
+            for (unsigned int n = 0; n < pwtx->tx->vout.size(); n++) {
+                UpdateSmallOutput(*pwtx, n, nMaxValue);
+            }
+            // Outputs spent by this transaction are gone, or back if it was abandoned or conflicted
+            for (const CTxIn& txin : pwtx->tx->vin) {
+                const CWalletTx* pprev = pwallet->GetWalletTx(txin.prevout.hash);
+                if (pprev && txin.prevout.n < pprev->tx->vout.size()) {
+                    UpdateSmallOutput(*pprev, txin.prevout.n, nMaxValue);
+                }
+            }
+        }
+    }
+}
 
-            COutPoint outpt(out.tx->GetHash(), out.i);
-            coinControl.Select(outpt);
-            vRewardCoins.push_back(out);
-            nTotalRewardsValue += out.GetValue();
+std::vector<CRewardManager::CombinePlan> CRewardManager::PlanCombineTransactions() {
+    std::vector<CombinePlan> vPlans;
+    const CAmount nThreshold = nAutoCombineAmountThreshold * COIN;
 
-            // Combine to the threshold and not way above
-            if (nTotalRewardsValue > nAutoCombineAmountThreshold * COIN)
-                break;
+    // Copy the candidate buckets, largest first, so the wallet lock below stays short
+    std::vector<std::pair<CBitcoinAddress, std::vector<std::pair<CAmount, COutPoint> > > > vBuckets;
+    {
+        LOCK(cs);
+        for (const auto& bucket : mapSmallOutputs) {
+            if (bucket.second.size() <= nAutoCombineNThreshold)
+                continue;
+            std::vector<std::pair<CAmount, COutPoint> > vOutputs;
+            vOutputs.reserve(bucket.second.size());
+            for (const auto& output : bucket.second) {
+                vOutputs.emplace_back(output.second, output.first);
+            }
+            vBuckets.emplace_back(bucket.first, std::move(vOutputs));
+        }
+    }
+    std::sort(vBuckets.begin(), vBuckets.end(), [](const decltype(vBuckets)::value_type& a, const decltype(vBuckets)::value_type& b) {
+        return a.second.size() > b.second.size();
+    });
+
+    for (auto& bucket : vBuckets) {
+        if (vPlans.size() >= AUTOCOMBINE_MAX_TXS_PER_CYCLE)
+            break;
+
+        std::vector<std::pair<CAmount, COutPoint> >& vOutputs = bucket.second;
+        {
+            LOCK2(cs_main, pwallet->cs_wallet);
+            vOutputs.erase(std::remove_if(vOutputs.begin(), vOutputs.end(), [&](const std::pair<CAmount, COutPoint>& output) {
+                const CWalletTx* pwtx = pwallet->GetWalletTx(output.second.hash);
+                return !pwtx || !IsCombinable(*pwtx, output.second.n);
+            }), vOutputs.end());
+        }
+        std::sort(vOutputs.begin(), vOutputs.end());
+
+        // Split the bucket into transactions which combine up to the threshold
+        // and stay below the standard size limit
+        size_t nNext = 0;
+        while (nNext < vOutputs.size() && vPlans.size() < AUTOCOMBINE_MAX_TXS_PER_CYCLE) {
+            CombinePlan plan;
+            plan.address = bucket.first;
+            plan.nTotal = 0;
+            plan.fMaxSize = false;
+            // we use 50 bytes as a base tx size (2 output: 2*34 + overhead: 10 -> 90 to be certain)
+            unsigned int txSizeEstimate = 90;
+            for (; nNext < vOutputs.size(); nNext++) {
+                plan.vInputs.push_back(vOutputs[nNext].second);
+                plan.nTotal += vOutputs[nNext].first;
+
+                // Combine to the threshold and not way above
+                if (plan.nTotal > nThreshold) {
+                    nNext++;
+                    break;
+                }
+
+                // Around 180 bytes per input. We use 190 to be certain
+                txSizeEstimate += 190;
+                if (txSizeEstimate >= MAX_STANDARD_TX_SIZE - 200) {
+                    plan.fMaxSize = true;
+                    nNext++;
+                    break;
+                }
+            }
 
-            // Around 180 bytes per input. We use 190 to be certain
-            txSizeEstimate += 190;
-            if (txSizeEstimate >= MAX_STANDARD_TX_SIZE - 200) {
-                maxSize = true;
+            // we want at least N inputs to combine, this also excludes combining a coin with itself
+            if (plan.vInputs.size() <= 1 || plan.vInputs.size() <= nAutoCombineNThreshold)
                 break;
-            }
+            vPlans.push_back(std::move(plan));
         }
+    }
+    return vPlans;
+}
 
-        //if no inputs found then return
-        if (!coinControl.HasSelected())
-            continue;
+bool CRewardManager::CommitCombineTransaction(const CombinePlan& plan) {
+    CCoinControl coinControl;
+    for (const COutPoint& outpoint : plan.vInputs) {
+        coinControl.Select(outpoint);
+    }
 
-        //we cannot combine one coin with itself
-        if (vRewardCoins.size() <= 1)
-            continue;
+    std::vector<CRecipient> vecSend;
+    int nChangePosRet = -1;
+    CScript scriptPubKey = GetScriptForDestination(plan.address.Get());
+    // 10% safety margin to avoid "Insufficient funds" errors
+    CRecipient recipient = {scriptPubKey, plan.nTotal - (plan.nTotal / 10), false};
+    vecSend.push_back(recipient);
 
-        //we want at least N inputs to combine
-        if (vRewardCoins.size() <= nAutoCombineNThreshold)
-            continue;
+    //Send change to same address
+    coinControl.destChange = plan.address.Get();
 
-        std::vector<CRecipient> vecSend;
-        int nChangePosRet = -1;
-        CScript scriptPubKey = GetScriptForDestination(it->first.Get());
-        // 10% safety margin to avoid "Insufficient funds" errors
-        CRecipient recipient = {scriptPubKey, nTotalRewardsValue - (nTotalRewardsValue / 10), false};
-        vecSend.push_back(recipient);
-
-        //Send change to same address
-        CTxDestination destMyAddress;
-        if (!ExtractDestination(scriptPubKey, destMyAddress)) {
-            LogPrintf("AutoCombineDust: failed to extract destination\n");
-            continue;
-        }
-        coinControl.destChange = destMyAddress;
+    // Create the transaction and commit it to the network
+    CWalletTx wtx;
+    CReserveKey keyChange(pwallet); // this change address does not end up being used, because change is returned with coin control switch
+    std::string strErr;
+    CAmount nFeeRet = 0;
 
-        // Create the transaction and commit it to the network
-        CWalletTx wtx;
-        CReserveKey keyChange(pwallet); // this change address does not end up being used, because change is returned with coin control switch
-        std::string strErr;
-        CAmount nFeeRet = 0;
+    if (!pwallet->CreateTransaction(vecSend, wtx, keyChange, nFeeRet, nChangePosRet, strErr, coinControl)) {
+        LogPrintf("AutoCombineDust createtransaction failed, reason: %s\n", strErr);
+        return false;
+    }
 
-        if (!pwallet->CreateTransaction(vecSend, wtx, keyChange, nFeeRet, nChangePosRet, strErr, coinControl)) {
-            LogPrintf("AutoCombineDust createtransaction failed, reason: %s\n", strErr);
-            continue;
-        }
+    //we don't combine below the threshold unless the fees are 0 to avoid paying fees over fees over fees
+    if (!plan.fMaxSize && plan.nTotal < nAutoCombineAmountThreshold * COIN && nFeeRet > 0)
+        return false;
 
-        //we don't combine below the threshold unless the fees are 0 to avoid paying fees over fees over fees
-        if (!maxSize && nTotalRewardsValue < nAutoCombineAmountThreshold * COIN && nFeeRet > 0)
-            continue;
+    CValidationState state;
+    if (!pwallet->CommitTransaction(wtx, keyChange, g_connman.get(), state)) {
+        LogPrintf("AutoCombineDust transaction commit failed\n");
+        return false;
+    }
 
-        CValidationState state;
-        if (!pwallet->CommitTransaction(wtx, keyChange, g_connman.get(), state)) {
-            LogPrintf("AutoCombineDust transaction commit failed\n");
-            continue;
+    // Don't plan these again before the wallet notification for wtx is processed
+    {
+        LOCK(cs);
+        for (const COutPoint& outpoint : plan.vInputs) {
+            RemoveSmallOutput(outpoint);
         }
-
-        LogPrintf("AutoCombineDust sent transaction\n");
-        // Max one transaction per cycle
-        break;
     }
+
+    LogPrintf("AutoCombineDust sent transaction %s (%d inputs)\n", wtx.GetHash().ToString(), plan.vInputs.size());
+    return true;
 }
 
-void CRewardManager::DoMaintenance(CConnman& connman) {
-    if (!IsReady()) {
-        MilliSleep(5 * 60 * 1000); // Wait 5 minutes
-        return;
+void CRewardManager::AutoCombineRewards() {
+    //coins are sectioned by address. This combination code only wants to combine inputs that belong to the same address
+    UpdateSmallOutputs();
+
+    for (const CombinePlan& plan : PlanCombineTransactions()) {
+        boost::this_thread::interruption_point();
+        CommitCombineTransaction(plan);
     }
+}
 
-    if (IsAutoCombineEnabled()) {
-        AutoCombineRewards();
-        int randsleep = GetRandInt(5 * 60 * 1000);
-        MilliSleep(randsleep); // Sleep between 3 and 8 minutes
+void CRewardManager::ThreadAutoCombine() {
+    while (true) {
+        if (!IsReady()) {
+            MilliSleep(5 * 60 * 1000); // Wait 5 minutes
+            continue;
+        }
+
+        if (IsAutoCombineEnabled()) {
+            AutoCombineRewards();
+        }
+        MilliSleep(3 * 60 * 1000 + GetRandInt(5 * 60 * 1000)); // Sleep between 3 and 8 minutes
     }
 }
@@ -7,15 +7,22 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "primitives/transaction.h"
 #include "sync.h"
 
-class CConnman;
+#include <boost/signals2/connection.hpp>
+
 class CRewardManager;
-class COutput;
 class CWallet;
+class CWalletTx;
 
 extern std::shared_ptr<CRewardManager> rewardManager;
 
+//! Maximum number of combine transactions sent per auto-combine cycle
+static const unsigned int AUTOCOMBINE_MAX_TXS_PER_CYCLE = 4;
+//! Number of changed wallet transactions processed per cs_wallet lock
+static const unsigned int AUTOCOMBINE_UPDATE_BATCH_SIZE = 100;
+
 class CRewardManager
 {
 public:
@@ -23,13 +30,41 @@ public:
 
 private:
     CWallet* pwallet = nullptr;
+    boost::signals2::connection connNotifyTransactionChanged;
+
+    /** A combine transaction planned for one address */
+    struct CombinePlan {
+        CBitcoinAddress address;
+        std::vector<COutPoint> vInputs;
+        CAmount nTotal;
+        bool fMaxSize;
+    };
+
+    //! Wallet outputs at or below the combine threshold, bucketed by address (protected by cs)
+    std::map<CBitcoinAddress, std::map<COutPoint, CAmount> > mapSmallOutputs;
+    std::map<COutPoint, CBitcoinAddress> mapSmallOutputAddress;
+    bool fSmallOutputsInitialized;
+
+    //! Wallet transactions changed since the buckets were last updated
+    CCriticalSection cs_changedTxs;
+    std::set<uint256> setChangedTxs;
+
+    void AddSmallOutput(const COutPoint& outpoint, const CBitcoinAddress& address, CAmount nValue);
+    void RemoveSmallOutput(const COutPoint& outpoint);
+    /** Add or remove output n of wtx from the buckets. Requires cs and pwallet->cs_wallet. */
+    void UpdateSmallOutput(const CWalletTx& wtx, unsigned int n, CAmount nMaxValue);
+    /** Whether output n of wtx can be spent by a combine transaction right now */
+    bool IsCombinable(const CWalletTx& wtx, unsigned int n) const;
+    /** Bring the buckets up to date, with a full wallet scan only the first time */
+    void UpdateSmallOutputs();
+    std::vector<CombinePlan> PlanCombineTransactions();
+    bool CommitCombineTransaction(const CombinePlan& plan);
 
 public:
     CRewardManager();
+    ~CRewardManager();
 
-    void BindWallet(CWallet * const pwalletIn) {
-        pwallet = pwalletIn;
-    }
+    void BindWallet(CWallet * const pwalletIn);
 
     bool fEnableRewardManager;
 
@@ -44,10 +79,10 @@ public:
     CAmount GetAutoCombineThresholdAmount() { return nAutoCombineAmountThreshold; };
     void AutoCombineSettings(bool fEnable, CAmount nAutoCombineAmountThresholdIn = 0);
 
-    std::map<CBitcoinAddress, std::vector<COutput> > AvailableCoinsByAddress(bool fConfirmed, CAmount maxCoinValue);
     void AutoCombineRewards();
 
-    void DoMaintenance(CConnman& connman);
+    /** Combine loop, runs on its own thread so it doesn't block the scheduler */
+    void ThreadAutoCombine();
 };
 
 #endif // REWARD_MANAGER_H
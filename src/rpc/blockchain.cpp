@@ -13,9 +13,12 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "coins.h"
+#include "coinstats.h"
+#include "ctpl.h"
 #include "core_io.h"
 #include "consensus/tokengroups.h"
 #include "consensus/validation.h"
+#include "dbcompaction.h"
 #include "validation.h"
 #include "core_io.h"
 #include "dstencode.h"
@@ -30,9 +33,12 @@
 #include "tokens/tokengroupmanager.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "undo.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "hash.h"
+#include "xion/xionchain.h"
+#include "xion/xionmodule.h"
 
 #include "evo/specialtx.h"
 #include "evo/cbtx.h"
@@ -47,6 +53,8 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
+#include <deque>
+#include <future>
 #include <mutex>
 #include <condition_variable>
 
@@ -892,6 +900,27 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
     return block;
 }
 
+static CBlockUndo GetUndoChecked(const CBlockIndex* pblockindex)
+{
+    CBlockUndo blockUndo;
+    if (pblockindex->pprev == nullptr) {
+        // The genesis block doesn't spend anything
+        return blockUndo;
+    }
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_UNDO)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Undo data not available (pruned data)");
+    }
+
+    if (!UndoReadFromDisk(blockUndo, pblockindex)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Can't read undo data from disk");
+    }
+
+    return blockUndo;
+}
+
+
+//! Maximum number of threads reading and filtering blocks for getmerkleblocks
+static const int MAX_MERKLEBLOCKS_WORKERS = 8;
 
 UniValue getmerkleblocks(const JSONRPCRequest& request)
 {
@@ -913,8 +942,6 @@ UniValue getmerkleblocks(const JSONRPCRequest& request)
             + HelpExampleRpc("getmerkleblocks", "\"2303028005802040100040000008008400048141010000f8400420800080025004000004130000000000000001\" \"00000000007e1432d2af52e8463278bf556b55cf5049262f25634557e2e91202\" 2000")
         );
 
-    LOCK(cs_main);
-
     CBloomFilter filter;
     std::string strFilter = request.params[0].get_str();
     CDataStream ssBloomFilter(ParseHex(strFilter), SER_NETWORK, PROTOCOL_VERSION);
@@ -927,10 +954,6 @@ UniValue getmerkleblocks(const JSONRPCRequest& request)
     std::string strHash = request.params[1].get_str();
     uint256 hash(uint256S(strHash));
 
-    if (mapBlockIndex.count(hash) == 0) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-    }
-
     int nCount = MAX_HEADERS_RESULTS;
     if (request.params.size() > 2)
         nCount = request.params[2].get_int();
@@ -939,32 +962,99 @@ UniValue getmerkleblocks(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Count is out of range");
     }
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-    CBlock block = GetBlockChecked(pblockindex);
+    // Collect the block positions, then read and filter the blocks without holding cs_main
+    std::vector<std::pair<uint256, CDiskBlockPos> > vBlocks;
+    {
+        LOCK(cs_main);
 
-    UniValue arrMerkleBlocks(UniValue::VARR);
+        if (mapBlockIndex.count(hash) == 0) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
 
-    for (; pblockindex; pblockindex = chainActive.Next(pblockindex))
+        for (CBlockIndex* pblockindex = mapBlockIndex[hash]; pblockindex && (int)vBlocks.size() < nCount; pblockindex = chainActive.Next(pblockindex)) {
+            if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0) {
+                throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+            }
+            vBlocks.emplace_back(pblockindex->GetBlockHash(), pblockindex->GetBlockPos());
+        }
+    }
+
+    // Filters which update themselves on matches must see the blocks in order, so only the block reads are
+    // parallelized for them. Other filters are applied by the workers too, on their own copy of the filter
+    const bool fSequentialFilter = filter.IsUpdating();
+
+    static CCriticalSection cs_pool;
+    static std::unique_ptr<ctpl::thread_pool> workerPool;
     {
-        if (--nCount < 0) {
-            break;
+        LOCK(cs_pool);
+        if (!workerPool) {
+            workerPool.reset(new ctpl::thread_pool(std::max(1, std::min(GetNumCores(), MAX_MERKLEBLOCKS_WORKERS))));
+            RenameThreadPool(*workerPool, "ion-merkleblk");
+        }
+    }
+
+    struct FilteredBlock {
+        std::shared_ptr<CBlock> pblock; // only kept for sequential filtering
+        std::string strHex;             // empty if the block did not match
+    };
+    auto processBlock = [&filter, fSequentialFilter](const uint256& hashBlock, const CDiskBlockPos& pos) {
+        FilteredBlock result;
+        auto pblock = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblock, pos, Params().GetConsensus()) || pblock->GetHash() != hashBlock) {
+            throw std::runtime_error("Block not found on disk");
         }
+        if (fSequentialFilter) {
+            result.pblock = std::move(pblock);
+            return result;
+        }
+        CBloomFilter filterCopy(filter);
+        CMerkleBlock merkleblock(*pblock, filterCopy);
+        if (!merkleblock.vMatchedTxn.empty()) {
+            CDataStream ssMerkleBlock(SER_NETWORK, PROTOCOL_VERSION);
+            ssMerkleBlock << merkleblock;
+            result.strHex = HexStr(ssMerkleBlock);
+        }
+        return result;
+    };
+
+    UniValue arrMerkleBlocks(UniValue::VARR);
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
-            // this shouldn't happen, we already checked pruning case earlier
-            throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    // Only a bounded window of blocks is in flight, results are appended in chain order
+    const size_t nWindow = (size_t)workerPool->size() * 4;
+    std::deque<std::future<FilteredBlock> > vFutures;
+    size_t nNext = 0;
+    while (nNext < vBlocks.size() || !vFutures.empty()) {
+        while (nNext < vBlocks.size() && vFutures.size() < nWindow) {
+            const auto& p = vBlocks[nNext++];
+            vFutures.emplace_back(workerPool->push([&processBlock, p](int) { return processBlock(p.first, p.second); }));
         }
 
-        CMerkleBlock merkleblock(block, filter);
-        if (merkleblock.vMatchedTxn.empty()) {
-            // ignore blocks that do not match the filter
-            continue;
+        FilteredBlock result;
+        try {
+            result = vFutures.front().get();
+        } catch (const std::exception& e) {
+            // wait for the remaining reads before leaving, they reference this stack frame
+            for (auto& f : vFutures) {
+                if (f.valid()) f.wait();
+            }
+            throw JSONRPCError(RPC_MISC_ERROR, e.what());
         }
+        vFutures.pop_front();
 
-        CDataStream ssMerkleBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssMerkleBlock << merkleblock;
-        std::string strHex = HexStr(ssMerkleBlock);
-        arrMerkleBlocks.push_back(strHex);
+        if (fSequentialFilter) {
+            CMerkleBlock merkleblock(*result.pblock, filter);
+            if (merkleblock.vMatchedTxn.empty()) {
+                continue;
+            }
+            CDataStream ssMerkleBlock(SER_NETWORK, PROTOCOL_VERSION);
+            ssMerkleBlock << merkleblock;
+            result.strHex = HexStr(ssMerkleBlock);
+        }
+
+        // ignore blocks that do not match the filter
+        if (!result.strHex.empty()) {
+            arrMerkleBlocks.push_back(result.strHex);
+        }
     }
     return arrMerkleBlocks;
 }
@@ -1079,8 +1169,7 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
         ss << VARINT(output.second.out.nValue);
         stats.nTransactionOutputs++;
         stats.nTotalAmount += output.second.out.nValue;
-        stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
-                           2 /* scriptPubKey len */ + output.second.out.scriptPubKey.size() /* scriptPubKey */;
+        stats.nBogoSize += GetBogoSize(output.second);
     }
     ss << VARINT(0);
 }
@@ -1174,29 +1263,65 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time with the default hash_type.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"    (string, optional, default=\"hash_serialized_2\") Which UTXO set hash should be calculated.\n"
+            "                   \"hash_serialized_2\" walks the whole UTXO set, \"muhash\" and \"none\" return the\n"
+            "                   incrementally maintained statistics of the current tip without touching the UTXO set.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions, only with hash_type \"hash_serialized_2\"\n"
             "  \"txouts\": n,            (numeric) The number of unspent transaction outputs\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash, only with hash_type \"hash_serialized_2\"\n"
+            "  \"muhash\": \"hash\",      (string) The order independent rolling hash, only with hash_type \"muhash\"\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    std::string strHashType = "hash_serialized_2";
+    if (!request.params[0].isNull()) {
+        strHashType = request.params[0].get_str();
+    }
+
     UniValue ret(UniValue::VOBJ);
 
+    if (strHashType == "muhash" || strHashType == "none") {
+        CUTXOStats stats;
+        int nHeight;
+        {
+            LOCK(cs_main);
+            if (!GetUTXOStatsTip(stats)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "UTXO set statistics are not available");
+            }
+            nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+        }
+        ret.push_back(Pair("height", (int64_t)nHeight));
+        ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+        ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+        ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
+        if (strHashType == "muhash") {
+            ret.push_back(Pair("muhash", stats.GetHash().GetHex()));
+        }
+        ret.push_back(Pair("disk_size", (uint64_t)pcoinsdbview->EstimateSize()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        return ret;
+    }
+    if (strHashType != "hash_serialized_2") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Unknown hash_type %s", strHashType));
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (GetUTXOStats(pcoinsdbview, stats)) {
@@ -1861,6 +1986,26 @@ static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&
 // outpoint (needed for the utxo index) + nHeight + fCoinBase + fCoinStake
 static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool) + sizeof(bool);
 
+/** Value of the zerocoin mints spent by tx, zerocoin spends don't have undo data for their inputs */
+static CAmount GetZerocoinSpendValue(const CTransaction& tx)
+{
+    CAmount nValueIn = 0;
+    for (const CTxIn& txin : tx.vin) {
+        if (txin.IsZerocoinPublicSpend()) {
+            // The denomination of a public spend is the one of the spent mint
+            CValidationState state;
+            PublicCoinSpend publicSpend(Params().Zerocoin_Params(false));
+            if (!XIONModule::ParseZerocoinPublicSpend(txin, tx, state, publicSpend)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Can't parse public zerocoin spend in transaction %s", tx.GetHash().ToString()));
+            }
+            nValueIn += publicSpend.getDenomination() * COIN;
+        } else if (txin.IsZerocoinSpend()) {
+            nValueIn += TxInToZerocoinSpend(txin).getDenomination() * COIN;
+        }
+    }
+    return nValueIn;
+}
+
 static UniValue getblockstats(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 4) {
@@ -1868,7 +2013,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
             "getblockstats hash_or_height ( stats )\n"
             "\nCompute per block statistics for a given window. All amounts are in duffs.\n"
             "It won't work for some heights with pruning.\n"
-            "It won't work without -txindex for utxo_size_inc, *fee or *feerate stats.\n"
+            "The coinstake transaction pays the block reward and is left out of the fee statistics.\n"
             "\nArguments:\n"
             "1. \"hash_or_height\"     (string or numeric, required) The block hash or height of the target block\n"
             "2. \"stats\"              (array,  optional) Values to plot, by default all values (see result below)\n"
@@ -1962,6 +2107,9 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     const bool do_calculate_size = do_all || do_mediantxsize ||
         SetHasKeys(stats, "total_size", "avgtxsize", "mintxsize", "maxtxsize", "avgfeerate", "medianfeerate", "minfeerate", "maxfeerate");
 
+    // The spent coins of all inputs come from the undo data, one read for the whole block
+    const CBlockUndo blockUndo = loop_inputs ? GetUndoChecked(pindex) : CBlockUndo();
+
     CAmount maxfee = 0;
     CAmount maxfeerate = 0;
     CAmount minfee = MAX_MONEY;
@@ -1978,7 +2126,8 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     std::vector<CAmount> feerate_array;
     std::vector<int64_t> txsize_array;
 
-    for (const auto& tx : block.vtx) {
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const auto& tx = block.vtx.at(i);
         outputs += tx->vout.size();
 
         CAmount tx_total_out = 0;
@@ -2010,25 +2159,28 @@ static UniValue getblockstats(const JSONRPCRequest& request)
 
         if (loop_inputs) {
 
-            if (!fTxIndex) {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, "One or more of the selected stats requires -txindex enabled");
+            if (blockUndo.vtxundo.size() != block.vtx.size() - 1) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Undo data doesn't match block");
             }
-            CAmount tx_total_in = 0;
-            for (const CTxIn& in : tx->vin) {
-                CTransactionRef tx_in;
-                uint256 hashBlock;
-                if (!GetTransaction(in.prevout.hash, tx_in, Params().GetConsensus(), hashBlock, false)) {
-                    throw JSONRPCError(RPC_INTERNAL_ERROR, std::string("Unexpected internal error (tx index seems corrupt)"));
-                }
-
-                CTxOut prevoutput = tx_in->vout[in.prevout.n];
+            // Zerocoin spends don't spend coins and have no undo entries for their inputs
+            const CTxUndo& txundo = blockUndo.vtxundo.at(i - 1);
+            CAmount tx_total_in = tx->HasZerocoinSpendInputs() ? GetZerocoinSpendValue(*tx) : 0;
+            for (const Coin& coin : txundo.vprevout) {
+                const CTxOut& prevoutput = coin.out;
 
                 tx_total_in += prevoutput.nValue;
                 utxo_size_inc -= GetSerializeSize(prevoutput, SER_NETWORK, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
             }
 
+            if (tx->IsCoinStake()) {
+                // Its outputs exceed its inputs by the block reward, there is no fee
+                continue;
+            }
+
             CAmount txfee = tx_total_in - tx_total_out;
-            assert(MoneyRange(txfee));
+            if (!MoneyRange(txfee)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Fee of transaction %s out of range", tx->GetHash().ToString()));
+            }
             if (do_medianfee) {
                 fee_array.push_back(txfee);
             }
@@ -2188,6 +2340,110 @@ UniValue getspecialtxes(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getspecialtxesbyheight(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 6)
+        throw std::runtime_error(
+            "getspecialtxesbyheight type startheight ( endheight count skip verbosity ) \n"
+            "Returns an array of special transactions mined in the specified range of blocks, ordered by height\n"
+            "Requires -specialtxindex.\n"
+            "\nIf verbosity is 0, returns tx hash for each transaction.\n"
+            "If verbosity is 1, returns hex-encoded data for each transaction.\n"
+            "If verbosity is 2, returns an Object with information for each transaction.\n"
+            "\nArguments:\n"
+            "1. type                 (numeric, required) Filter special txes by type, -1 means all types\n"
+            "2. startheight          (numeric, required) The height of the first block to search\n"
+            "3. endheight            (numeric, optional, default=current height) The height of the last block to search\n"
+            "4. count                (numeric, optional, default=100) The number of transactions to return\n"
+            "5. skip                 (numeric, optional, default=0) The number of transactions to skip\n"
+            "6. verbosity            (numeric, optional, default=0) 0 for hashes, 1 for hex-encoded data, and 2 for json object\n"
+            "\nResult (for verbosity = 0):\n"
+            "[\n"
+            "  \"txid\" : \"xxxx\",    (string) The transaction id\n"
+            "]\n"
+            "\nResult (for verbosity = 1):\n"
+            "[\n"
+            "  \"data\",               (string) A string that is serialized, hex-encoded data for the transaction\n"
+            "]\n"
+            "\nResult (for verbosity = 2):\n"
+            "[                       (array of Objects) The transactions in the format of the getrawtransaction RPC.\n"
+            "  ...,\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getspecialtxesbyheight", "1 1000 2000")
+            + HelpExampleRpc("getspecialtxesbyheight", "1, 1000, 2000")
+        );
+
+    if (!fSpecialTxIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Special tx index not enabled, restart with -specialtxindex and -reindex");
+
+    LOCK(cs_main);
+
+    int nTxType = request.params[0].get_int();
+
+    int nStartHeight = request.params[1].get_int();
+    int nEndHeight = chainActive.Height();
+    if (request.params.size() > 2) {
+        nEndHeight = request.params[2].get_int();
+    }
+    if (nStartHeight < 0 || nEndHeight < nStartHeight || nEndHeight > chainActive.Height())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+
+    int nCount = 100;
+    if (request.params.size() > 3) {
+        nCount = request.params[3].get_int();
+        if (nCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+    }
+
+    int nSkip = 0;
+    if (request.params.size() > 4) {
+        nSkip = request.params[4].get_int();
+        if (nSkip < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative skip");
+    }
+
+    int nVerbosity = 0;
+    if (request.params.size() > 5) {
+        nVerbosity = request.params[5].get_int();
+        if (nVerbosity < 0 || nVerbosity > 2) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range 0..2");
+        }
+    }
+
+    std::vector<CSpecialTxIndexEntry> entries = GetSpecialTxIndexEntries(nTxType, nStartHeight, nEndHeight, nSkip, nCount);
+
+    // Entries are ordered by height, so each block is only read once
+    const CBlockIndex* pblockindex = nullptr;
+    CBlock block;
+
+    UniValue result(UniValue::VARR);
+    for (const CSpecialTxIndexEntry& entry : entries) {
+        if (nVerbosity == 0) {
+            result.push_back(entry.txid.GetHex());
+            continue;
+        }
+
+        if (pblockindex == nullptr || pblockindex->nHeight != entry.nHeight) {
+            pblockindex = chainActive[entry.nHeight];
+            block = GetBlockChecked(pblockindex);
+        }
+        if (entry.nTxIndex >= block.vtx.size() || block.vtx[entry.nTxIndex]->GetHash() != entry.txid)
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Special tx index is inconsistent with the active chain");
+        const CTransaction& tx = *block.vtx[entry.nTxIndex];
+
+        if (nVerbosity == 1) {
+            result.push_back(EncodeHexTx(tx));
+        } else {
+            UniValue objTx(UniValue::VOBJ);
+            TxToJSON(tx, pblockindex->GetBlockHash(), objTx);
+            result.push_back(objTx);
+        }
+    }
+
+    return result;
+}
+
 //! Search for a given set of pubkey scripts
 bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
     scan_progress = 0;
@@ -2271,6 +2527,92 @@ CTxDestination GetDestinationForKey(const CPubKey& key, OutputScriptType type)
     }
 }
 
+UniValue compactdb(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "compactdb \"action\" ( \"name\" )\n"
+            "\nCompacts the LevelDB databases in the background and reports their statistics.\n"
+            "\nArguments:\n"
+            "1. \"action\"       (string, required) The action to execute\n"
+            "                      \"start\" for queuing a compaction\n"
+            "                      \"abort\" for aborting the current compaction (returns true when abort was successful)\n"
+            "                      \"status\" for progress report of the current compaction and database statistics\n"
+            "2. \"name\"         (string, optional, default=\"all\") The database to compact, e.g. \"chainstate\" or \"blocks/index\"\n"
+            "\nResult (for \"status\"):\n"
+            "{\n"
+            "  \"compacting\": \"name\",         (string) The database being compacted, if any\n"
+            "  \"progress\": x.xxx,            (numeric) Progress of the current compaction in %\n"
+            "  \"queued\": [ \"name\", ... ],    (array) Databases waiting for compaction\n"
+            "  \"databases\": [\n"
+            "    {\n"
+            "      \"name\": \"name\",             (string) The database name\n"
+            "      \"size_mb\": x.xxx,            (numeric) Size on disk in MB\n"
+            "      \"bytes_written\": n,          (numeric) Bytes written by the node since the database was opened\n"
+            "      \"write_amplification\": x.xxx, (numeric) Bytes written by LevelDB per byte written by the node\n"
+            "      \"levels\": [ { \"level\": n, \"files\": n, \"size_mb\": x.xxx }, ... ],\n"
+            "      \"last_compaction\": ttt       (numeric) Time of the last manual compaction, 0 if none\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("compactdb", "start chainstate")
+            + HelpExampleCli("compactdb", "status")
+            + HelpExampleRpc("compactdb", "\"start\", \"chainstate\""));
+
+    RPCTypeCheck(request.params, {UniValue::VSTR, UniValue::VSTR});
+
+    const std::string& strAction = request.params[0].get_str();
+    if (strAction == "start") {
+        std::string strName = request.params[1].isNull() ? "all" : request.params[1].get_str();
+        if (!dbCompactionManager.Enqueue(strName)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Unknown database %s", strName));
+        }
+        return true;
+    } else if (strAction == "abort") {
+        return dbCompactionManager.Abort();
+    } else if (strAction != "status") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid command");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    std::string strCompacting;
+    double dProgress;
+    std::vector<std::string> vQueued;
+    dbCompactionManager.GetProgress(strCompacting, dProgress, vQueued);
+    if (!strCompacting.empty()) {
+        result.pushKV("compacting", strCompacting);
+        result.pushKV("progress", dProgress * 100);
+    }
+    UniValue queued(UniValue::VARR);
+    for (const std::string& strName : vQueued) {
+        queued.push_back(strName);
+    }
+    result.pushKV("queued", queued);
+
+    UniValue databases(UniValue::VARR);
+    for (const CDBStats& stats : dbCompactionManager.GetStats()) {
+        UniValue db(UniValue::VOBJ);
+        db.pushKV("name", stats.strName);
+        db.pushKV("size_mb", stats.GetSizeMB());
+        db.pushKV("bytes_written", stats.nBytesWritten);
+        db.pushKV("write_amplification", stats.GetWriteAmplification());
+        UniValue levels(UniValue::VARR);
+        for (const CDBStats::Level& level : stats.vLevels) {
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("level", level.nLevel);
+            obj.pushKV("files", level.nFiles);
+            obj.pushKV("size_mb", level.dSizeMB);
+            levels.push_back(obj);
+        }
+        db.pushKV("levels", levels);
+        db.pushKV("last_compaction", stats.nLastCompactionTime);
+        databases.push_back(db);
+    }
+    result.pushKV("databases", databases);
+    return result;
+}
+
 UniValue scantxoutset(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -2612,6 +2954,7 @@ UniValue scantokens(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ ----------
+    { "blockchain",         "compactdb",              &compactdb,              true,  {"action", "name"} },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        true,  {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          true,  {"hash_or_height", "stats"} },
@@ -2632,8 +2975,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "getspecialtxes",         &getspecialtxes,         true,  {"blockhash", "type", "count", "skip", "verbosity"} },
+    { "blockchain",         "getspecialtxesbyheight", &getspecialtxesbyheight, true,  {"type", "startheight", "endheight", "count", "skip", "verbosity"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"hash_type"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
 
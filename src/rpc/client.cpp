@@ -177,6 +177,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getspecialtxes", 2, "count" },
     { "getspecialtxes", 3, "skip" },
     { "getspecialtxes", 4, "verbosity" },
+    { "getspecialtxesbyheight", 0, "type" },
+    { "getspecialtxesbyheight", 1, "startheight" },
+    { "getspecialtxesbyheight", 2, "endheight" },
+    { "getspecialtxesbyheight", 3, "count" },
+    { "getspecialtxesbyheight", 4, "skip" },
+    { "getspecialtxesbyheight", 5, "verbosity" },
     { "disconnectnode", 1, "nodeid" },
     { "setstakesplitthreshold", 0, "value" },
     { "autocombinerewards", 0, "enable" },
@@ -884,7 +884,19 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
     // Use CTransaction for the constant parts of the
     // transaction to avoid rehashing.
     const CTransaction txConst(mtx);
-    // Sign what we can:
+    // Sign what we can, all inputs at once:
+    std::vector<CTxOut> vSpentOutputs(mtx.vin.size());
+    for (unsigned int i = 0; i < mtx.vin.size(); i++) {
+        const Coin& coin = view.AccessCoin(mtx.vin[i].prevout);
+        // Only sign SIGHASH_SINGLE if there's a corresponding output:
+        if (!coin.IsSpent() && (!fHashSingle || (i < mtx.vout.size())))
+            vSpentOutputs[i] = coin.out;
+    }
+    // Not all inputs have to be signed: unknown prevouts stay unsigned and are
+    // reported as errors below, other signatures may be added later
+    std::vector<SignatureData> vSigData;
+    ProduceSignatures(keystore, txConst, vSpentOutputs, nHashType, vSigData);
+
     for (unsigned int i = 0; i < mtx.vin.size(); i++) {
         CTxIn& txin = mtx.vin[i];
         const Coin& coin = view.AccessCoin(txin.prevout);
@@ -895,11 +907,7 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
         const CScript& prevPubKey = coin.out.scriptPubKey;
         const CAmount& amount = coin.out.nValue;
 
-        SignatureData sigdata;
-        // Only sign SIGHASH_SINGLE if there's a corresponding output:
-        if (!fHashSingle || (i < mtx.vout.size()))
-            ProduceSignature(MutableTransactionSignatureCreator(&keystore, &mtx, i, amount, nHashType), prevPubKey, sigdata);
-        sigdata = CombineSignatures(prevPubKey, TransactionSignatureChecker(&txConst, i, amount), sigdata, DataFromTransaction(mtx, i));
+        SignatureData sigdata = CombineSignatures(prevPubKey, TransactionSignatureChecker(&txConst, i, amount), vSigData[i], DataFromTransaction(mtx, i));
 
         UpdateTransaction(mtx, i, sigdata);
 
@@ -12,6 +12,12 @@
 #include "primitives/transaction.h"
 #include "script/standard.h"
 #include "uint256.h"
+#include "util.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 
 typedef std::vector<unsigned char> valtype;
@@ -153,6 +159,116 @@ bool ProduceSignature(const BaseSignatureCreator& creator, const CScript& fromPu
     return solved && VerifyScript(sigdata.scriptSig, fromPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, creator.Checker());
 }
 
+namespace {
+/** Produces dummy signatures like DummySignatureCreator, but copies every key
+ *  it is asked for into a separate keystore */
+class KeyCollectingSignatureCreator : public DummySignatureCreator {
+    CBasicKeyStore& keystoreOut;
+
+public:
+    KeyCollectingSignatureCreator(const CKeyStore* keystoreIn, CBasicKeyStore& keystoreOutIn) : DummySignatureCreator(keystoreIn), keystoreOut(keystoreOutIn) {}
+    bool CreateSig(std::vector<unsigned char>& vchSig, const CKeyID& keyid, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        CKey key;
+        if (!keystoreOut.HaveKey(keyid)) {
+            if (!keystore->GetKey(keyid, key))
+                return false;
+            keystoreOut.AddKeyPubKey(key, key.GetPubKey());
+        }
+        return DummySignatureCreator::CreateSig(vchSig, keyid, scriptCode, sigversion);
+    }
+};
+} // namespace
+
+bool ProduceSignatures(const CKeyStore& keystore, const CTransaction& txTo, const std::vector<CTxOut>& vSpentOutputs, int nHashType,
+                       std::vector<SignatureData>& vSigData, std::vector<bool>* pvfSigned)
+{
+    assert(vSpentOutputs.size() == txTo.vin.size());
+    const unsigned int nInputs = txTo.vin.size();
+
+    // Resolve all keys and redeem scripts up front. Wallets may have to take
+    // their own locks or derive HD keys for this, which must not happen on
+    // the worker threads while the caller holds those locks.
+    CBasicKeyStore keystoreSign;
+    KeyCollectingSignatureCreator collector(&keystore, keystoreSign);
+    for (unsigned int nIn = 0; nIn < nInputs; nIn++) {
+        const CScript& scriptPubKey = vSpentOutputs[nIn].scriptPubKey;
+        if (scriptPubKey.empty())
+            continue;
+        SignatureData sigdata;
+        ProduceSignature(collector, scriptPubKey, sigdata);
+        // For P2SH the last push of the scriptSig is the redeem script
+        std::vector<unsigned char> vchLastPush, vchPush;
+        opcodetype opcode;
+        CScript::const_iterator pc = sigdata.scriptSig.begin();
+        while (sigdata.scriptSig.GetOp(pc, opcode, vchPush)) {
+            vchLastPush = vchPush;
+        }
+        CScript redeemScript(vchLastPush.begin(), vchLastPush.end());
+        if (!vchLastPush.empty() && keystore.HaveCScript(CScriptID(redeemScript))) {
+            keystoreSign.AddCScript(redeemScript);
+        }
+    }
+
+    vSigData.assign(nInputs, SignatureData());
+    std::vector<char> vfSigned(nInputs, false);
+    auto signInput = [&](unsigned int nIn) {
+        const CScript& scriptPubKey = vSpentOutputs[nIn].scriptPubKey;
+        if (scriptPubKey.empty())
+            return;
+        TransactionSignatureCreator creator(&keystoreSign, &txTo, nIn, vSpentOutputs[nIn].nValue, nHashType);
+        vfSigned[nIn] = ProduceSignature(creator, scriptPubKey, vSigData[nIn]);
+    };
+
+    unsigned int nThreads = 1;
+    if (nInputs >= PARALLEL_SIGNING_MIN_INPUTS) {
+        nThreads = std::max(1, std::min(GetNumCores(), (int)(nInputs / (PARALLEL_SIGNING_MIN_INPUTS / 2))));
+    }
+    if (nThreads <= 1) {
+        for (unsigned int nIn = 0; nIn < nInputs; nIn++) {
+            signInput(nIn);
+        }
+    } else {
+        // Every worker takes the next unsigned input, results go to their input's slot
+        std::atomic<unsigned int> nNextInput(0);
+        std::exception_ptr pException;
+        std::mutex cs_exception;
+        std::vector<std::thread> vThreads;
+        for (unsigned int i = 0; i < nThreads; i++) {
+            vThreads.emplace_back([&]() {
+                try {
+                    for (unsigned int nIn = nNextInput++; nIn < nInputs; nIn = nNextInput++) {
+                        signInput(nIn);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(cs_exception);
+                    pException = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : vThreads) {
+            thread.join();
+        }
+        if (pException) {
+            std::rethrow_exception(pException);
+        }
+    }
+
+    bool fAllSigned = true;
+    if (pvfSigned) {
+        pvfSigned->assign(nInputs, false);
+    }
+    for (unsigned int nIn = 0; nIn < nInputs; nIn++) {
+        if (pvfSigned) {
+            (*pvfSigned)[nIn] = vfSigned[nIn];
+        }
+        if (!vfSigned[nIn]) {
+            fAllSigned = false;
+        }
+    }
+    return fAllSigned;
+}
+
 SignatureData DataFromTransaction(const CMutableTransaction& tx, unsigned int nIn)
 {
     SignatureData data;
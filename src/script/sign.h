@@ -13,9 +13,13 @@ class CKeyID;
 class CKeyStore;
 class CScript;
 class CTransaction;
+class CTxOut;
 
 struct CMutableTransaction;
 
+/** Transactions with at least this many inputs are signed on several threads */
+static const unsigned int PARALLEL_SIGNING_MIN_INPUTS = 16;
+
 /** Virtual base class for signature creators. */
 class BaseSignatureCreator {
 protected:
@@ -70,6 +74,16 @@ struct SignatureData {
 /** Produce a script signature using a generic signature creator. */
 bool ProduceSignature(const BaseSignatureCreator& creator, const CScript& scriptPubKey, SignatureData& sigdata);
 
+/** Produce script signatures for all inputs of txTo, which spend vSpentOutputs
+ *  (in input order). Keys and scripts are only looked up in keystore on the
+ *  calling thread, so the caller may hold locks the keystore needs; they are
+ *  resolved once per key and the inputs of larger transactions are then
+ *  signed on several threads. Inputs whose spent scriptPubKey is empty (e.g.
+ *  an unknown prevout) are not signed. vSigData and, if given, vfSigned
+ *  receive one entry per input. Returns true if all inputs were signed. */
+bool ProduceSignatures(const CKeyStore& keystore, const CTransaction& txTo, const std::vector<CTxOut>& vSpentOutputs, int nHashType,
+                       std::vector<SignatureData>& vSigData, std::vector<bool>* pvfSigned = nullptr);
+
 /** Produce a script signature for a transaction. */
 bool SignSignature(const CKeyStore &keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, const CAmount& amount, int nHashType);
 bool SignSignature(const CKeyStore& keystore, const CTransaction& txFrom, CMutableTransaction& txTo, unsigned int nIn, int nHashType);
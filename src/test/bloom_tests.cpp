@@ -7,6 +7,7 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "core_memusage.h"
 #include "key.h"
 #include "merkleblock.h"
 #include "random.h"
@@ -178,6 +179,31 @@ BOOST_AUTO_TEST_CASE(bloom_match)
     BOOST_CHECK_MESSAGE(!filter.IsRelevantAndUpdate(tx), "Simple Bloom filter matched COutPoint for an output we didn't care about");
 }
 
+BOOST_AUTO_TEST_CASE(bloom_match_shared_elements)
+{
+    // Same transaction as in bloom_match, checked by filters with different tweaks through the same elements
+    CDataStream stream(ParseHex("01000000010b26e9b7735eb6aabdf358bab62f9816a21ba9ebdb719d5299e88607d722c190000000008b4830450220070aca44506c5cef3a16ed519d7c3c39f8aab192c4e1c90d065f37b8a4af6141022100a8e160b856c2d43d27d8fba71e5aef6405b8643ac4cb7cb3c462aced7f14711a0141046d11fee51b0e60666d5049a9101a72741df480b96ee26488a4d3466b95c9a40ac5eeef87e10a5cd336c19a84565f80fa6c547957b7700ff4dfbdefe76036c339ffffffff021bff3d11000000001976a91404943fdd508053c75000106d3bc6e2754dbcff1988ac2f15de00000000001976a914a266436d2965547608b9e15d9032a7b9d64fa43188ac00000000"), SER_DISK, CLIENT_VERSION);
+    CTransactionRef tx = MakeTransactionRef(CTransaction(deserialize, stream));
+
+    std::shared_ptr<const CBloomTxElements> elements = GetBloomTxElements(tx);
+    BOOST_CHECK(GetBloomTxElements(tx) == elements);
+    BOOST_CHECK(elements->DynamicMemoryUsage() >= RecursiveDynamicUsage(tx));
+
+    CBloomFilter filterAddress(10, 0.000001, 0, BLOOM_UPDATE_ALL);
+    filterAddress.insert(ParseHex("04943fdd508053c75000106d3bc6e2754dbcff19"));
+    BOOST_CHECK_MESSAGE(filterAddress.IsRelevantAndUpdate(*elements), "Shared elements didn't match output address");
+    BOOST_CHECK_MESSAGE(filterAddress.contains(COutPoint(tx->GetHash(), 0)), "Shared elements didn't add output");
+    BOOST_CHECK(!filterAddress.contains(COutPoint(tx->GetHash(), 1)));
+
+    CBloomFilter filterPrevOut(10, 0.000001, 100, BLOOM_UPDATE_NONE);
+    filterPrevOut.insert(COutPoint(uint256S("0x90c122d70786e899529d71dbeba91ba216982fb6ba58f3bdaab65e73b7e9260b"), 0));
+    BOOST_CHECK_MESSAGE(filterPrevOut.IsRelevantAndUpdate(*elements), "Shared elements didn't match COutPoint");
+
+    CBloomFilter filterRandom(10, 0.000001, 5, BLOOM_UPDATE_ALL);
+    filterRandom.insert(ParseHex("0000006d2965547608b9e15d9032a7b9d64fa431"));
+    BOOST_CHECK_MESSAGE(!filterRandom.IsRelevantAndUpdate(*elements), "Shared elements matched random address");
+}
+
 BOOST_AUTO_TEST_CASE(dip2_bloom_match)
 {
     // ProRegTx from testnet (txid: 39a1339d9bf26de701345beecc5de75a690bc9533741a3dbe90f2fd88b8ed461)
@@ -306,6 +332,13 @@ BOOST_AUTO_TEST_CASE(merkle_block_1)
     for (unsigned int i = 0; i < vMatched.size(); i++)
         BOOST_CHECK(vMatched[i] == merkleBlock.vMatchedTxn[i].second);
 
+    // Same matches through the shared elements of the block
+    CBloomFilter filterShared(10, 0.000001, 0, BLOOM_UPDATE_ALL);
+    filterShared.insert(uint256S("0x74d681e0e03bafa802c8aa084379aa98d9fcd632ddc2ed9782b586ec87451f20"));
+    std::shared_ptr<const CBloomBlockElements> elements = GetBloomBlockElements(block.GetHash(), block.vtx);
+    BOOST_CHECK(GetBloomBlockElements(block.GetHash(), block.vtx) == elements);
+    BOOST_CHECK(CMerkleBlock(block, filterShared, elements.get()).vMatchedTxn == merkleBlock.vMatchedTxn);
+
     // Also match the 8th transaction
     filter.insert(uint256S("0xdd1fd2a6fc16404faf339881a90adbde7f4f728691ac62e8f168809cdfae1053"));
     merkleBlock = CMerkleBlock(block, filter);
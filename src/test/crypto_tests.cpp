@@ -6,6 +6,7 @@
 #include "crypto/aes.h"
 #include "crypto/chacha20.h"
 #include "crypto/chacha_poly_aead.h"
+#include "crypto/muhash.h"
 #include "crypto/poly1305.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
@@ -784,4 +785,62 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+static std::string MuHashHex(MuHash3072 muhash)
+{
+    unsigned char hash[MuHash3072::OUTPUT_SIZE];
+    muhash.Finalize(hash);
+    return HexStr(hash, hash + sizeof(hash));
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    // The empty set hashes the serialized number one
+    BOOST_CHECK_EQUAL(MuHashHex(MuHash3072()), "c85525462fdcf30a2c18d6f4b92923000974355c2477f59594d2c205a1d25add");
+
+    std::vector<std::vector<unsigned char> > vElements;
+    for (int i = 0; i < 8; i++) {
+        vElements.push_back(ParseHex(strprintf("%08x", InsecureRand32())));
+    }
+
+    MuHash3072 forward, backward;
+    for (size_t i = 0; i < vElements.size(); i++) {
+        forward.Insert(vElements[i].data(), vElements[i].size());
+        backward.Insert(vElements[vElements.size() - 1 - i].data(), vElements[vElements.size() - 1 - i].size());
+    }
+    // Order doesn't matter
+    BOOST_CHECK_EQUAL(MuHashHex(forward), MuHashHex(backward));
+    BOOST_CHECK(MuHashHex(forward) != MuHashHex(MuHash3072()));
+
+    // Removing an element undoes inserting it, also before it was inserted
+    MuHash3072 removed = forward;
+    removed.Remove(vElements[0].data(), vElements[0].size());
+    MuHash3072 partial;
+    partial.Remove(vElements[0].data(), vElements[0].size());
+    for (size_t i = 0; i < vElements.size(); i++) {
+        partial.Insert(vElements[i].data(), vElements[i].size());
+    }
+    BOOST_CHECK_EQUAL(MuHashHex(partial), MuHashHex(forward));
+    removed.Insert(vElements[0].data(), vElements[0].size());
+    BOOST_CHECK_EQUAL(MuHashHex(removed), MuHashHex(forward));
+
+    // Combining sets
+    MuHash3072 first, second;
+    for (size_t i = 0; i < vElements.size(); i++) {
+        (i % 2 ? first : second).Insert(vElements[i].data(), vElements[i].size());
+    }
+    MuHash3072 combined = first;
+    combined *= second;
+    BOOST_CHECK_EQUAL(MuHashHex(combined), MuHashHex(forward));
+    combined /= second;
+    BOOST_CHECK_EQUAL(MuHashHex(combined), MuHashHex(first));
+
+    // Serialization roundtrip keeps the pending denominator
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << removed;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 deserialized;
+    ss >> deserialized;
+    BOOST_CHECK_EQUAL(MuHashHex(deserialized), MuHashHex(forward));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -118,6 +118,45 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+// Test compacting by key prefix and the registry of open databases
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_prefix)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    create_directories(ph);
+    std::string strName;
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, false);
+        strName = dbw.GetName();
+        BOOST_CHECK(!strName.empty());
+
+        CDBBatch batch(dbw);
+        for (int i = 0; i < 1000; i++) {
+            batch.Write(std::make_pair('a', i), InsecureRand256());
+            batch.Write(std::make_pair('b', i), InsecureRand256());
+        }
+        BOOST_CHECK(dbw.WriteBatch(batch));
+        BOOST_CHECK(dbw.GetBytesWritten() >= batch.SizeEstimate());
+
+        for (unsigned int nPrefix = 0; nPrefix < 256; nPrefix++) {
+            dbw.CompactPrefix(nPrefix);
+        }
+        BOOST_CHECK(dbw.EstimatePrefixSize('a') > 0);
+        BOOST_CHECK_EQUAL(dbw.EstimatePrefixSize('c'), 0);
+        BOOST_CHECK(dbw.Exists(std::make_pair('b', 999)));
+
+        // compacting in steps by the second key byte
+        dbw.CompactPrefix('b', 0, 128);
+        dbw.CompactPrefix('b', 128, 256);
+        BOOST_CHECK(dbw.Exists(std::make_pair('b', 999)));
+        BOOST_CHECK(dbw.Exists(std::make_pair('b', 0)));
+
+        bool fFound = false;
+        BOOST_CHECK(WithDBWrapper(strName, [&](CDBWrapper& db) { fFound = &db == &dbw; }));
+        BOOST_CHECK(fFound);
+    }
+    BOOST_CHECK(!WithDBWrapper(strName, [](CDBWrapper&) {}));
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
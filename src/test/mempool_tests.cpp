@@ -581,4 +581,130 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolClusterTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    /* low fee parent */
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx1.GetHash(), entry.Fee(1000LL).FromTx(tx1));
+
+    /* high fee child of tx1 */
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vin[0].scriptSig = CScript() << OP_11;
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx2.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx2.GetHash(), entry.Fee(50000LL).FromTx(tx2));
+
+    /* unrelated medium fee transaction */
+    CMutableTransaction tx3 = CMutableTransaction();
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx3.vout[0].nValue = 5 * COIN;
+    pool.addUnchecked(tx3.GetHash(), entry.Fee(10000LL).FromTx(tx3));
+
+    std::vector<CTxMemPool::ClusterChunks> vClusters;
+    BOOST_CHECK_EQUAL(pool.GetClusterChunks(vClusters), 0);
+    BOOST_CHECK_EQUAL(vClusters.size(), 2);
+    for (const auto& chunks : vClusters) {
+        // tx2 pays for tx1, so both end up in a single chunk, parent first
+        BOOST_CHECK_EQUAL(chunks.size(), 1);
+        if (chunks[0].txs.size() == 2) {
+            BOOST_CHECK(chunks[0].txs[0]->GetTx().GetHash() == tx1.GetHash());
+            BOOST_CHECK(chunks[0].txs[1]->GetTx().GetHash() == tx2.GetHash());
+            BOOST_CHECK_EQUAL(chunks[0].nModFees, 51000LL);
+        } else {
+            BOOST_CHECK(chunks[0].txs[0]->GetTx().GetHash() == tx3.GetHash());
+        }
+    }
+
+    /* zero fee child of tx2 and tx3 joins both clusters */
+    CTxMemPool::setEntries setAncestors;
+    setAncestors.insert(pool.mapTx.find(tx2.GetHash()));
+    setAncestors.insert(pool.mapTx.find(tx3.GetHash()));
+    BOOST_CHECK_EQUAL(pool.CalculateClusterSize(setAncestors), 4);
+
+    CMutableTransaction tx4 = CMutableTransaction();
+    tx4.vin.resize(2);
+    tx4.vin[0].prevout = COutPoint(tx2.GetHash(), 0);
+    tx4.vin[0].scriptSig = CScript() << OP_11;
+    tx4.vin[1].prevout = COutPoint(tx3.GetHash(), 0);
+    tx4.vin[1].scriptSig = CScript() << OP_11;
+    tx4.vout.resize(1);
+    tx4.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx4.vout[0].nValue = 15 * COIN;
+    pool.addUnchecked(tx4.GetHash(), entry.Fee(0LL).FromTx(tx4));
+
+    vClusters.clear();
+    pool.GetClusterChunks(vClusters);
+    BOOST_CHECK_EQUAL(vClusters.size(), 1);
+    // Chunks: {tx1, tx2}, {tx3}, {tx4}
+    BOOST_CHECK_EQUAL(vClusters[0].size(), 3);
+    BOOST_CHECK_EQUAL(vClusters[0][0].txs.size(), 2);
+    BOOST_CHECK(vClusters[0][1].txs[0]->GetTx().GetHash() == tx3.GetHash());
+    BOOST_CHECK(vClusters[0][2].txs[0]->GetTx().GetHash() == tx4.GetHash());
+
+    // Excluding transactions already in a block linearizes the rest again
+    CTxMemPool::setEntries setInBlock;
+    setInBlock.insert(pool.mapTx.find(tx1.GetHash()));
+    vClusters.clear();
+    BOOST_CHECK_EQUAL(pool.GetClusterChunks(vClusters, setInBlock), 1);
+    BOOST_CHECK_EQUAL(vClusters.size(), 1);
+    BOOST_CHECK(vClusters[0][0].txs[0]->GetTx().GetHash() == tx2.GetHash());
+
+    // Removing the only link between the two halves splits the cluster again
+    pool.removeRecursive(tx4);
+    vClusters.clear();
+    pool.GetClusterChunks(vClusters);
+    BOOST_CHECK_EQUAL(vClusters.size(), 2);
+
+    pool.removeRecursive(tx1);
+    vClusters.clear();
+    pool.GetClusterChunks(vClusters);
+    BOOST_CHECK_EQUAL(vClusters.size(), 1);
+    BOOST_CHECK(vClusters[0][0].txs[0]->GetTx().GetHash() == tx3.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolClusterLimitTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    // Clusters above the limit (e.g. after a reorg) are linearized by ancestor feerate
+    pool.setClusterLimit(1);
+
+    std::vector<CMutableTransaction> vChain;
+    for (int i = 0; i < 4; i++) {
+        CMutableTransaction tx = CMutableTransaction();
+        if (i > 0) {
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(vChain.back().GetHash(), 0);
+            tx.vin[0].scriptSig = CScript() << OP_11;
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        // low fee parents, a high fee last child
+        pool.addUnchecked(tx.GetHash(), entry.Fee(i == 3 ? 100000LL : 1000LL).FromTx(tx));
+        vChain.push_back(tx);
+    }
+
+    std::vector<CTxMemPool::ClusterChunks> vClusters;
+    pool.GetClusterChunks(vClusters);
+    BOOST_CHECK_EQUAL(vClusters.size(), 1);
+    // The child pays for the whole chain, which is mined in order as one chunk
+    BOOST_CHECK_EQUAL(vClusters[0].size(), 1);
+    BOOST_CHECK_EQUAL(vClusters[0][0].txs.size(), 4);
+    for (size_t i = 0; i < vChain.size() && i < vClusters[0][0].txs.size(); i++) {
+        BOOST_CHECK(vClusters[0][0].txs[i]->GetTx().GetHash() == vChain[i].GetHash());
+    }
+    BOOST_CHECK_EQUAL(vClusters[0][0].nModFees, 103000LL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
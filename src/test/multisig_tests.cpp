@@ -214,5 +214,70 @@ BOOST_AUTO_TEST_CASE(multisig_Sign)
     }
 }
 
+BOOST_AUTO_TEST_CASE(multisig_ProduceSignatures)
+{
+    // Test that signing all inputs at once (on several threads) gives the
+    // same scriptSigs as SignSignature() one input at a time
+    CBasicKeyStore keystore;
+    CKey key[4];
+    for (int i = 0; i < 4; i++)
+    {
+        key[i].MakeNewKey(true);
+        if (i < 3)
+            keystore.AddKey(key[i]);
+    }
+
+    CScript escrow;
+    escrow << OP_2 << ToByteVector(key[0].GetPubKey()) << ToByteVector(key[1].GetPubKey()) << ToByteVector(key[2].GetPubKey()) << OP_3 << OP_CHECKMULTISIG;
+    keystore.AddCScript(escrow);
+
+    const unsigned int nInputs = 4 * PARALLEL_SIGNING_MIN_INPUTS;
+    CMutableTransaction txFrom;  // Funding transaction
+    txFrom.vout.resize(nInputs);
+    for (unsigned int i = 0; i < nInputs; i++)
+    {
+        switch (i % 4) {
+        case 0: txFrom.vout[i].scriptPubKey = GetScriptForDestination(key[i % 3].GetPubKey().GetID()); break;
+        case 1: txFrom.vout[i].scriptPubKey = escrow; break;
+        case 2: txFrom.vout[i].scriptPubKey = GetScriptForDestination(CScriptID(escrow)); break;
+        case 3: txFrom.vout[i].scriptPubKey = GetScriptForDestination(key[3].GetPubKey().GetID()); break;
+        }
+        txFrom.vout[i].nValue = 1000 + i;
+    }
+
+    CMutableTransaction txTo;
+    txTo.vin.resize(nInputs);
+    txTo.vout.resize(1);
+    txTo.vout[0].nValue = 1;
+    for (unsigned int i = 0; i < nInputs; i++)
+    {
+        txTo.vin[i].prevout.n = i;
+        txTo.vin[i].prevout.hash = txFrom.GetHash();
+    }
+
+    std::vector<SignatureData> vSigData;
+    std::vector<bool> vfSigned;
+    // key[3] is not in the keystore
+    BOOST_CHECK(!ProduceSignatures(keystore, CTransaction(txTo), txFrom.vout, SIGHASH_ALL, vSigData, &vfSigned));
+    BOOST_CHECK_EQUAL(vSigData.size(), nInputs);
+
+    for (unsigned int i = 0; i < nInputs; i++)
+    {
+        CMutableTransaction txSerial(txTo);
+        bool fSigned = SignSignature(keystore, txFrom, txSerial, i, SIGHASH_ALL);
+        BOOST_CHECK_EQUAL(fSigned, i % 4 != 3);
+        BOOST_CHECK_EQUAL(vfSigned[i], fSigned);
+        if (fSigned)
+            BOOST_CHECK(vSigData[i].scriptSig == txSerial.vin[i].scriptSig);
+    }
+    // An input with an unknown spent output counts as not signed
+    std::vector<CTxOut> vSpentOutputs(nInputs, txFrom.vout[0]);
+    vSpentOutputs[1] = CTxOut();
+    BOOST_CHECK(!ProduceSignatures(keystore, CTransaction(txTo), vSpentOutputs, SIGHASH_ALL, vSigData, &vfSigned));
+    BOOST_CHECK(vfSigned[0]);
+    BOOST_CHECK(!vfSigned[1]);
+    BOOST_CHECK(vSigData[1].scriptSig.empty());
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
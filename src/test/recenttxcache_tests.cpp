@@ -0,0 +1,83 @@
+// Copyright (c) 2020 The Ion Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "recenttxcache.h"
+#include "primitives/block.h"
+#include "test/test_ion.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(recenttxcache_tests, BasicTestingSetup)
+
+static CBlock MakeBlock(int nTxs, uint32_t nSeed)
+{
+    CBlock block;
+    block.nNonce = nSeed;
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = nSeed;
+        tx.vin[0].scriptSig = CScript() << i;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(recenttxcache_blocks)
+{
+    CRecentTxCache cache(2, 32 * 1024 * 1024);
+    CBlock block1 = MakeBlock(3, 1), block2 = MakeBlock(3, 2), block3 = MakeBlock(3, 3);
+
+    CTransactionRef tx;
+    uint256 hashBlock;
+    cache.AddBlock(block1, block1.GetHash());
+    BOOST_CHECK(cache.Get(block1.vtx[1]->GetHash(), tx, hashBlock));
+    BOOST_CHECK(tx == block1.vtx[1]);
+    BOOST_CHECK(hashBlock == block1.GetHash());
+    BOOST_CHECK(!cache.Get(block2.vtx[1]->GetHash(), tx, hashBlock));
+
+    // the oldest block is evicted first
+    cache.AddBlock(block2, block2.GetHash());
+    cache.AddBlock(block3, block3.GetHash());
+    BOOST_CHECK_EQUAL(cache.BlockCount(), 2U);
+    BOOST_CHECK(!cache.Get(block1.vtx[0]->GetHash(), tx, hashBlock));
+    BOOST_CHECK(cache.Get(block2.vtx[0]->GetHash(), tx, hashBlock));
+    BOOST_CHECK(cache.Get(block3.vtx[2]->GetHash(), tx, hashBlock));
+
+    // disconnected blocks are dropped
+    cache.RemoveBlock(block3.GetHash());
+    BOOST_CHECK_EQUAL(cache.BlockCount(), 1U);
+    BOOST_CHECK(!cache.Get(block3.vtx[2]->GetHash(), tx, hashBlock));
+    BOOST_CHECK(cache.Get(block2.vtx[2]->GetHash(), tx, hashBlock));
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.BlockCount(), 0U);
+    BOOST_CHECK(!cache.Get(block2.vtx[2]->GetHash(), tx, hashBlock));
+}
+
+BOOST_AUTO_TEST_CASE(recenttxcache_memory)
+{
+    CBlock block1 = MakeBlock(100, 1), block2 = MakeBlock(100, 2);
+
+    CRecentTxCache unbounded(10, 32 * 1024 * 1024);
+    unbounded.AddBlock(block1, block1.GetHash());
+    size_t nBlockUsage = unbounded.DynamicMemoryUsage();
+    BOOST_CHECK(nBlockUsage > 0);
+
+    // only one block fits
+    CRecentTxCache cache(10, nBlockUsage * 3 / 2);
+    cache.AddBlock(block1, block1.GetHash());
+    cache.AddBlock(block2, block2.GetHash());
+    BOOST_CHECK_EQUAL(cache.BlockCount(), 1U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= nBlockUsage * 3 / 2);
+
+    CTransactionRef tx;
+    uint256 hashBlock;
+    BOOST_CHECK(!cache.Get(block1.vtx[0]->GetHash(), tx, hashBlock));
+    BOOST_CHECK(cache.Get(block2.vtx[0]->GetHash(), tx, hashBlock));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -877,7 +877,7 @@ extern UniValue configuretokendryrun(const JSONRPCRequest& request)
         // Add XDM inputs
         if (XDMFeeNeeded > 0) {
             CTokenGroupID XDMGrpID = tokenGroupManager->GetDarkMatterID();
-            pwallet->FilterCoins(coins, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
+            pwallet->FilterGroupCoins(coins, XDMGrpID, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
                 CTokenGroupInfo tg(out->scriptPubKey);
                 if ((XDMGrpID == tg.associatedGroup) && !tg.isAuthority())
                 {
@@ -1046,7 +1046,7 @@ extern UniValue configuretoken(const JSONRPCRequest& request)
         // Add XDM inputs
         if (XDMFeeNeeded > 0) {
             CTokenGroupID XDMGrpID = tokenGroupManager->GetDarkMatterID();
-            pwallet->FilterCoins(coins, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
+            pwallet->FilterGroupCoins(coins, XDMGrpID, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
                 CTokenGroupInfo tg(out->scriptPubKey);
                 if ((XDMGrpID == tg.associatedGroup) && !tg.isAuthority())
                 {
@@ -1130,7 +1130,7 @@ extern UniValue configuremanagementtoken(const JSONRPCRequest& request)
 
         std::vector<COutput> coins;
         CAmount lowest = MAX_MONEY;
-        pwallet->FilterCoins(coins, [&lowest, magicID](const CWalletTx *tx, const CTxOut *out) {
+        pwallet->FilterGroupCoins(coins, magicID, [&lowest, magicID](const CWalletTx *tx, const CTxOut *out) {
             CTokenGroupInfo tg(out->scriptPubKey);
             // although its possible to spend a grouped input to produce
             // a single mint group, I won't allow it to make the tx construction easier.
@@ -1289,7 +1289,7 @@ extern UniValue createtokenauthorities(const JSONRPCRequest& request)
 
     // Now find a compatible authority
     std::vector<COutput> coins;
-    int nOptions = pwallet->FilterCoins(coins, [auth, grpID](const CWalletTx *tx, const CTxOut *out) {
+    int nOptions = pwallet->FilterGroupCoins(coins, grpID, [auth, grpID](const CWalletTx *tx, const CTxOut *out) {
         CTokenGroupInfo tg(out->scriptPubKey);
         if ((tg.associatedGroup == grpID) && tg.isAuthority() && tg.allowsRenew())
         {
@@ -1304,7 +1304,7 @@ extern UniValue createtokenauthorities(const JSONRPCRequest& request)
     if ((nOptions == 0) && (grpID.isSubgroup()))
     {
         // if its a subgroup look for a parent authority that will work
-        nOptions = pwallet->FilterCoins(coins, [auth, grpID](const CWalletTx *tx, const CTxOut *out) {
+        nOptions = pwallet->FilterGroupCoins(coins, grpID.parentGroup(), [auth, grpID](const CWalletTx *tx, const CTxOut *out) {
             CTokenGroupInfo tg(out->scriptPubKey);
             if (tg.isAuthority() && tg.allowsRenew() && tg.allowsSubgroup() &&
                 (tg.associatedGroup == grpID.parentGroup()))
@@ -1596,7 +1596,7 @@ extern UniValue minttoken(const JSONRPCRequest& request)
 
     // Now find a mint authority
     std::vector<COutput> coins;
-    int nOptions = pwallet->FilterCoins(coins, [grpID](const CWalletTx *tx, const CTxOut *out) {
+    int nOptions = pwallet->FilterGroupCoins(coins, grpID, [grpID](const CWalletTx *tx, const CTxOut *out) {
         CTokenGroupInfo tg(out->scriptPubKey);
         if ((tg.associatedGroup == grpID) && tg.allowsMint())
         {
@@ -1611,7 +1611,7 @@ extern UniValue minttoken(const JSONRPCRequest& request)
     if ((nOptions == 0) && (grpID.isSubgroup()))
     {
         // if its a subgroup look for a parent authority that will work
-        nOptions = pwallet->FilterCoins(coins, [grpID](const CWalletTx *tx, const CTxOut *out) {
+        nOptions = pwallet->FilterGroupCoins(coins, grpID.parentGroup(), [grpID](const CWalletTx *tx, const CTxOut *out) {
             CTokenGroupInfo tg(out->scriptPubKey);
             if (tg.isAuthority() && tg.allowsRenew() && tg.allowsSubgroup() && tg.allowsMint() &&
                 (tg.associatedGroup == grpID.parentGroup()))
@@ -1658,7 +1658,7 @@ extern UniValue minttoken(const JSONRPCRequest& request)
         // Add XDM inputs
         if (XDMFeeNeeded > 0) {
             CTokenGroupID XDMGrpID = tokenGroupManager->GetDarkMatterID();
-            pwallet->FilterCoins(coins, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
+            pwallet->FilterGroupCoins(coins, XDMGrpID, [XDMGrpID, &totalXDMAvailable](const CWalletTx *tx, const CTxOut *out) {
                 CTokenGroupInfo tg(out->scriptPubKey);
                 if ((XDMGrpID == tg.associatedGroup) && !tg.isAuthority())
                 {
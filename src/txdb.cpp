@@ -32,6 +32,7 @@ static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
+static const char DB_UTXO_STATS = 'U';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
@@ -141,6 +142,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
     batch.Write(DB_BEST_BLOCK, hashBlock);
+    // Keep the UTXO stats only if they describe the new state
+    if (pendingUTXOStats && pendingUTXOStats->hashBlock == hashBlock) {
+        batch.Write(DB_UTXO_STATS, *pendingUTXOStats);
+    } else {
+        batch.Erase(DB_UTXO_STATS);
+    }
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = db.WriteBatch(batch);
@@ -153,6 +160,21 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+bool CCoinsViewDB::ReadUTXOStats(CUTXOStats& stats) const
+{
+    return db.Read(DB_UTXO_STATS, stats);
+}
+
+bool CCoinsViewDB::WriteUTXOStats(const CUTXOStats& stats)
+{
+    return db.Write(DB_UTXO_STATS, stats);
+}
+
+void CCoinsViewDB::SetPendingUTXOStats(const CUTXOStats* stats)
+{
+    pendingUTXOStats.reset(stats ? new CUTXOStats(*stats) : nullptr);
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
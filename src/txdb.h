@@ -8,11 +8,13 @@
 #define BITCOIN_TXDB_H
 
 #include "coins.h"
+#include "coinstats.h"
 #include "dbwrapper.h"
 #include "chain.h"
 #include "spentindex.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -70,10 +72,11 @@ class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    //! Statistics written with the coins of the matching best block
+    std::unique_ptr<CUTXOStats> pendingUTXOStats;
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
@@ -84,6 +87,11 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    bool ReadUTXOStats(CUTXOStats& stats) const;
+    bool WriteUTXOStats(const CUTXOStats& stats);
+    //! Stats to persist atomically with the next BatchWrite of stats.hashBlock, nullptr to drop them
+    void SetPendingUTXOStats(const CUTXOStats* stats);
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
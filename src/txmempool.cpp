@@ -345,6 +345,7 @@ CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator) :
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     nCheckFrequency = 0;
+    nClusterLimit = DEFAULT_CLUSTER_LIMIT;
 }
 
 bool CTxMemPool::isSpent(const COutPoint& outpoint)
@@ -373,7 +374,15 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // all the appropriate checks.
     LOCK(cs);
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
-    mapLinks.insert(make_pair(newit, TxLinks()));
+    // Start out in a cluster of our own, UpdateParent() below merges it with
+    // the clusters of any in-mempool parents
+    TxLinks links;
+    links.nClusterId = nNextClusterId++;
+    mapLinks.insert(make_pair(newit, links));
+    setEntries s;
+    if (mapClusters[links.nClusterId].txs.insert(newit).second) {
+        cachedClusterUsage += memusage::IncrementalDynamicUsage(s);
+    }
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting
@@ -473,9 +482,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
 
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    IndexUpdate update(tx.GetHash());
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -486,20 +494,17 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, delta);
         }
     }
 
@@ -508,30 +513,26 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            update.addressDeltas.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    QueueIndexUpdate(std::move(update));
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
-    LOCK(cs);
+    LOCK(cs_index);
+    ApplyIndexQueue();
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
         while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
@@ -544,7 +545,7 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
-    LOCK(cs);
+    AssertLockHeld(cs_index);
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
@@ -560,10 +561,8 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 
 void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
-
     const CTransaction& tx = entry.GetTx();
-    std::vector<CSpentIndexKey> inserted;
+    IndexUpdate update(tx.GetHash());
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -590,17 +589,16 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
         CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
-
+        update.spentValues.emplace_back(key, value);
     }
 
-    mapSpentInserted.insert(make_pair(txhash, inserted));
+    QueueIndexUpdate(std::move(update));
 }
 
 bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
-    LOCK(cs);
+    LOCK(cs_index);
+    ApplyIndexQueue();
     mapSpentIndex::iterator it;
 
     it = mapSpent.find(key);
@@ -613,7 +611,7 @@ bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 
 bool CTxMemPool::removeSpentIndex(const uint256 txhash)
 {
-    LOCK(cs);
+    AssertLockHeld(cs_index);
     mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
 
     if (it != mapSpentInserted.end()) {
@@ -627,6 +625,52 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     return true;
 }
 
+void CTxMemPool::QueueIndexUpdate(IndexUpdate&& update)
+{
+    fIndexQueueUsed = true;
+    LOCK(cs_indexQueue);
+    vIndexQueue.emplace_back(std::move(update));
+}
+
+void CTxMemPool::ApplyIndexQueue()
+{
+    AssertLockHeld(cs_index);
+
+    std::vector<IndexUpdate> queue;
+    {
+        LOCK(cs_indexQueue);
+        queue.swap(vIndexQueue);
+    }
+
+    for (auto& update : queue) {
+        if (update.fRemove) {
+            removeAddressIndex(update.txhash);
+            removeSpentIndex(update.txhash);
+            continue;
+        }
+        if (!update.addressDeltas.empty()) {
+            auto& inserted = mapAddressInserted[update.txhash];
+            for (const auto& p : update.addressDeltas) {
+                mapAddress.insert(p);
+                inserted.push_back(p.first);
+            }
+        }
+        if (!update.spentValues.empty()) {
+            auto& inserted = mapSpentInserted[update.txhash];
+            for (const auto& p : update.spentValues) {
+                mapSpent.insert(p);
+                inserted.push_back(p.first);
+            }
+        }
+    }
+}
+
+void CTxMemPool::FlushIndexQueue()
+{
+    LOCK(cs_index);
+    ApplyIndexQueue();
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     NotifyEntryRemoved(it->GetSharedTx(), reason);
@@ -691,12 +735,29 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
+    const uint64_t nClusterId = mapLinks[it].nClusterId;
+    auto clusterIt = mapClusters.find(nClusterId);
+    assert(clusterIt != mapClusters.end());
+    setEntries s;
+    if (clusterIt->second.txs.erase(it)) {
+        cachedClusterUsage -= memusage::IncrementalDynamicUsage(s);
+    }
+    InvalidateClusterChunks(clusterIt->second);
+    if (clusterIt->second.txs.empty()) {
+        setClustersToSplit.erase(nClusterId);
+        mapClusters.erase(clusterIt);
+    } else {
+        setClustersToSplit.insert(nClusterId);
+    }
     mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
-    removeAddressIndex(hash);
-    removeSpentIndex(hash);
+    if (fIndexQueueUsed) {
+        IndexUpdate update(hash);
+        update.fRemove = true;
+        QueueIndexUpdate(std::move(update));
+    }
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -989,6 +1050,10 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 void CTxMemPool::_clear()
 {
     mapLinks.clear();
+    mapClusters.clear();
+    setClustersToSplit.clear();
+    nNextClusterId = 0;
+    cachedClusterUsage = 0;
     mapTx.clear();
     mapNextTx.clear();
     mapProTxAddresses.clear();
@@ -1028,6 +1093,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     uint64_t checkTotal = 0;
     uint64_t innerUsage = 0;
+    uint64_t nClusterTxs = 0;
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
     const int64_t spendheight = GetSpendHeight(mempoolDuplicate);
@@ -1043,6 +1109,14 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         assert(linksiter != mapLinks.end());
         const TxLinks &links = linksiter->second;
         innerUsage += memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children);
+        // Check that the transaction is in the same cluster as its parents.
+        auto clusterIt = mapClusters.find(links.nClusterId);
+        assert(clusterIt != mapClusters.end());
+        assert(clusterIt->second.txs.count(it));
+        for (txiter parentIt : links.parents) {
+            assert(mapLinks.find(parentIt)->second.nClusterId == links.nClusterId);
+        }
+        nClusterTxs++;
         bool fDependsWait = false;
         setEntries setParentCheck;
         int64_t parentSizes = 0;
@@ -1136,6 +1210,11 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+    uint64_t nClusterTxsCheck = 0;
+    for (const auto& pair : mapClusters) {
+        nClusterTxsCheck += pair.second.txs.size();
+    }
+    assert(nClusterTxs == nClusterTxsCheck);
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb)
@@ -1329,6 +1408,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, update_fee_delta(delta));
+            InvalidateClusterChunks(mapClusters[mapLinks[it].nClusterId]);
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
             uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -1395,7 +1475,7 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage + memusage::DynamicUsage(mapClusters) + memusage::DynamicUsage(setClustersToSplit) + cachedClusterUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -1404,6 +1484,7 @@ void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPool
     for (const txiter& it : stage) {
         removeUnchecked(it, reason);
     }
+    SplitClusters();
 }
 
 int CTxMemPool::Expire(int64_t time) {
@@ -1452,9 +1533,306 @@ void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
     setEntries s;
     if (add && mapLinks[entry].parents.insert(parent).second) {
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
+        MergeClusters(mapLinks[entry].nClusterId, mapLinks[parent].nClusterId);
     } else if (!add && mapLinks[entry].parents.erase(parent)) {
         cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+        const uint64_t nClusterId = mapLinks[entry].nClusterId;
+        InvalidateClusterChunks(mapClusters[nClusterId]);
+        setClustersToSplit.insert(nClusterId);
+    }
+}
+
+void CTxMemPool::MergeClusters(uint64_t nClusterIdA, uint64_t nClusterIdB)
+{
+    if (nClusterIdA == nClusterIdB)
+        return;
+    auto itA = mapClusters.find(nClusterIdA);
+    auto itB = mapClusters.find(nClusterIdB);
+    assert(itA != mapClusters.end() && itB != mapClusters.end());
+    if (itA->second.txs.size() < itB->second.txs.size()) {
+        std::swap(itA, itB);
+    }
+    // Move the smaller cluster B into A; the member set usage stays the same
+    TxCluster& clusterA = itA->second;
+    InvalidateClusterChunks(clusterA);
+    InvalidateClusterChunks(itB->second);
+    for (txiter it : itB->second.txs) {
+        mapLinks[it].nClusterId = itA->first;
+        clusterA.txs.insert(it);
+    }
+    if (setClustersToSplit.erase(itB->first)) {
+        setClustersToSplit.insert(itA->first);
+    }
+    mapClusters.erase(itB);
+}
+
+void CTxMemPool::SplitClusters()
+{
+    for (uint64_t nClusterId : setClustersToSplit) {
+        auto clusterIt = mapClusters.find(nClusterId);
+        if (clusterIt == mapClusters.end())
+            continue;
+        TxCluster& cluster = clusterIt->second;
+        setEntries setRemaining = cluster.txs;
+        bool fFirst = true;
+        while (!setRemaining.empty()) {
+            // Walk the connected component of an arbitrary remaining transaction
+            setEntries setComponent;
+            std::vector<txiter> vStack(1, *setRemaining.begin());
+            setRemaining.erase(setRemaining.begin());
+            while (!vStack.empty()) {
+                txiter it = vStack.back();
+                vStack.pop_back();
+                setComponent.insert(it);
+                const TxLinks& links = mapLinks[it];
+                for (const setEntries* pset : {&links.parents, &links.children}) {
+                    for (txiter relIt : *pset) {
+                        if (setRemaining.erase(relIt)) {
+                            vStack.push_back(relIt);
+                        }
+                    }
+                }
+            }
+            // The first component keeps the cluster id, all others get a new cluster
+            if (fFirst) {
+                fFirst = false;
+                continue;
+            }
+            const uint64_t nNewClusterId = nNextClusterId++;
+            TxCluster& newCluster = mapClusters[nNewClusterId];
+            for (txiter it : setComponent) {
+                cluster.txs.erase(it);
+                newCluster.txs.insert(it);
+                mapLinks[it].nClusterId = nNewClusterId;
+            }
+            InvalidateClusterChunks(cluster);
+        }
+    }
+    setClustersToSplit.clear();
+}
+
+static size_t ClusterChunksUsage(const CTxMemPool::ClusterChunks& chunks)
+{
+    size_t nUsage = memusage::DynamicUsage(chunks);
+    for (const auto& chunk : chunks) {
+        nUsage += memusage::DynamicUsage(chunk.txs);
+    }
+    return nUsage;
+}
+
+void CTxMemPool::InvalidateClusterChunks(TxCluster& cluster)
+{
+    if (cluster.chunks.empty())
+        return;
+    cachedClusterUsage -= ClusterChunksUsage(cluster.chunks);
+    ClusterChunks().swap(cluster.chunks);
+}
+
+const CTxMemPool::ClusterChunks& CTxMemPool::GetCachedChunks(TxCluster& cluster)
+{
+    if (cluster.chunks.empty() && !cluster.txs.empty()) {
+        cluster.chunks = LinearizeCluster(std::vector<txiter>(cluster.txs.begin(), cluster.txs.end()));
+        cachedClusterUsage += ClusterChunksUsage(cluster.chunks);
+    }
+    return cluster.chunks;
+}
+
+// Start a new chunk with the next transaction of a linearization and merge it into its
+// predecessor as long as it has a higher feerate, which keeps chunk feerates non-increasing.
+static void AppendToChunks(CTxMemPool::ClusterChunks& chunks, CTxMemPool::txiter it)
+{
+    CTxMemPool::ClusterChunk chunk;
+    chunk.txs.push_back(it);
+    chunk.nModFees = it->GetModifiedFee();
+    chunk.nSize = it->GetTxSize();
+    chunk.nSigOps = it->GetSigOpCount();
+    chunks.push_back(std::move(chunk));
+    while (chunks.size() > 1) {
+        CTxMemPool::ClusterChunk& last = chunks[chunks.size() - 1];
+        CTxMemPool::ClusterChunk& prev = chunks[chunks.size() - 2];
+        if ((double)last.nModFees * prev.nSize <= (double)prev.nModFees * last.nSize)
+            break;
+        prev.txs.insert(prev.txs.end(), last.txs.begin(), last.txs.end());
+        prev.nModFees += last.nModFees;
+        prev.nSize += last.nSize;
+        prev.nSigOps += last.nSigOps;
+        chunks.pop_back();
+    }
+}
+
+CTxMemPool::ClusterChunks CTxMemPool::LinearizeByAncestorFee(const std::vector<txiter>& vTxs) const
+{
+    std::vector<txiter> vSorted(vTxs);
+    std::sort(vSorted.begin(), vSorted.end(), [](txiter a, txiter b) {
+        return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+    });
+
+    // Transactions of vTxs which were not appended yet
+    setEntries setRemaining(vTxs.begin(), vTxs.end());
+    ClusterChunks chunks;
+    for (txiter it : vSorted) {
+        if (!setRemaining.count(it))
+            continue;
+        // Collect the remaining ancestors of it, each transaction is visited once over the whole loop
+        std::vector<txiter> vSelected;
+        std::vector<txiter> vStack(1, it);
+        setRemaining.erase(it);
+        while (!vStack.empty()) {
+            txiter cur = vStack.back();
+            vStack.pop_back();
+            vSelected.push_back(cur);
+            for (txiter parentIt : GetMemPoolParents(cur)) {
+                if (setRemaining.erase(parentIt)) {
+                    vStack.push_back(parentIt);
+                }
+            }
+        }
+        // Parents before children: an ancestor always has fewer in-mempool ancestors
+        std::sort(vSelected.begin(), vSelected.end(), [](txiter a, txiter b) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        });
+        for (txiter selIt : vSelected) {
+            AppendToChunks(chunks, selIt);
+        }
+    }
+    return chunks;
+}
+
+CTxMemPool::ClusterChunks CTxMemPool::LinearizeCluster(const std::vector<txiter>& vTxs) const
+{
+    // Clusters only grow past the limit when a reorg returns transactions to the
+    // mempool; don't spend cubic time on them
+    if (vTxs.size() > nClusterLimit) {
+        return LinearizeByAncestorFee(vTxs);
+    }
+
+    // Repeatedly pick the transaction whose not yet picked ancestors have the
+    // highest feerate, like the ancestor feerate based block assembly did for
+    // the whole mempool, but confined to a single bounded cluster.
+    const size_t n = vTxs.size();
+    std::map<txiter, size_t, CompareIteratorByHash> mapIndex;
+    for (size_t i = 0; i < n; i++) {
+        mapIndex.emplace(vTxs[i], i);
+    }
+
+    // vAncestors[i][j] is set if vTxs[j] is vTxs[i] or one of its ancestors within vTxs
+    std::vector<std::vector<bool> > vAncestors(n, std::vector<bool>(n, false));
+    std::vector<CAmount> vFees(n, 0);
+    std::vector<uint64_t> vSizes(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        std::vector<size_t> vStack(1, i);
+        vAncestors[i][i] = true;
+        while (!vStack.empty()) {
+            const size_t j = vStack.back();
+            vStack.pop_back();
+            vFees[i] += vTxs[j]->GetModifiedFee();
+            vSizes[i] += vTxs[j]->GetTxSize();
+            for (txiter parentIt : GetMemPoolParents(vTxs[j])) {
+                auto indexIt = mapIndex.find(parentIt);
+                // Parents outside of vTxs are already mined or excluded
+                if (indexIt == mapIndex.end() || vAncestors[i][indexIt->second])
+                    continue;
+                vAncestors[i][indexIt->second] = true;
+                vStack.push_back(indexIt->second);
+            }
+        }
+    }
+
+    ClusterChunks chunks;
+    std::vector<bool> vDone(n, false);
+    size_t nDone = 0;
+    while (nDone < n) {
+        size_t nBest = n;
+        for (size_t i = 0; i < n; i++) {
+            if (vDone[i])
+                continue;
+            if (nBest == n) {
+                nBest = i;
+                continue;
+            }
+            double f1 = (double)vFees[i] * vSizes[nBest];
+            double f2 = (double)vFees[nBest] * vSizes[i];
+            if (f1 > f2 || (f1 == f2 && vSizes[i] < vSizes[nBest])) {
+                nBest = i;
+            }
+        }
+
+        // Append the remaining ancestors of nBest, parents before children:
+        // an ancestor always has fewer ancestors within the selection than its descendants.
+        std::vector<std::pair<size_t, size_t> > vSelected;
+        for (size_t j = 0; j < n; j++) {
+            if (!vDone[j] && vAncestors[nBest][j]) {
+                vSelected.emplace_back(0, j);
+            }
+        }
+        for (auto& sel : vSelected) {
+            for (const auto& other : vSelected) {
+                if (vAncestors[sel.second][other.second]) {
+                    sel.first++;
+                }
+            }
+        }
+        std::sort(vSelected.begin(), vSelected.end());
+
+        for (const auto& sel : vSelected) {
+            const size_t j = sel.second;
+            vDone[j] = true;
+            nDone++;
+            for (size_t i = 0; i < n; i++) {
+                if (!vDone[i] && vAncestors[i][j]) {
+                    vFees[i] -= vTxs[j]->GetModifiedFee();
+                    vSizes[i] -= vTxs[j]->GetTxSize();
+                }
+            }
+
+            AppendToChunks(chunks, vTxs[j]);
+        }
+    }
+    return chunks;
+}
+
+uint64_t CTxMemPool::CalculateClusterSize(const setEntries &setAncestors)
+{
+    LOCK(cs);
+    SplitClusters();
+    // The new transaction joins the clusters of all its ancestors
+    std::set<uint64_t> setClusterIds;
+    uint64_t nClusterSize = 1;
+    for (txiter it : setAncestors) {
+        const uint64_t nClusterId = mapLinks[it].nClusterId;
+        if (setClusterIds.insert(nClusterId).second) {
+            nClusterSize += mapClusters[nClusterId].txs.size();
+        }
+    }
+    return nClusterSize;
+}
+
+int CTxMemPool::GetClusterChunks(std::vector<ClusterChunks>& vClusters, const setEntries& setExclude)
+{
+    LOCK(cs);
+    SplitClusters();
+    int nRelinearized = 0;
+    vClusters.reserve(vClusters.size() + mapClusters.size());
+    for (auto& pair : mapClusters) {
+        TxCluster& cluster = pair.second;
+        if (!setExclude.empty()) {
+            std::vector<txiter> vTxs;
+            for (txiter it : cluster.txs) {
+                if (!setExclude.count(it)) {
+                    vTxs.push_back(it);
+                }
+            }
+            if (vTxs.empty())
+                continue;
+            if (vTxs.size() != cluster.txs.size()) {
+                vClusters.push_back(LinearizeCluster(vTxs));
+                nRelinearized++;
+                continue;
+            }
+        }
+        vClusters.push_back(GetCachedChunks(cluster));
     }
+    return nRelinearized;
 }
 
 const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
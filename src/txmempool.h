@@ -7,6 +7,7 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <map>
@@ -411,6 +412,22 @@ public:
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
+ * Transaction clusters:
+ *
+ * Every transaction also belongs to exactly one cluster, the connected
+ * component of the parent/child graph it is in.  Clusters are merged when a
+ * link is added (addUnchecked(), UpdateTransactionsFromBlock()) and split
+ * lazily after removals.  For each cluster we cache a linearization (a
+ * topologically valid order in which to mine its transactions) split into
+ * chunks of non-increasing feerate, which is the cluster's feerate diagram.
+ * The cache is invalidated whenever the cluster or the modified fee of one of
+ * its transactions changes.  BlockAssembler selects transactions chunk by
+ * chunk instead of re-walking ancestor sets, and AcceptToMemoryPool() bounds
+ * the size of the cluster a new transaction would create.  Transactions of
+ * disconnected blocks are added back without that check, so a reorg can
+ * still merge clusters past the limit; those clusters are linearized by
+ * ancestor feerate instead, which is cheap but may pick worse chunks.
+ *
  * Computational limits:
  *
  * Updating all in-mempool ancestors of a newly added transaction can be slow,
@@ -423,6 +440,7 @@ class CTxMemPool
 {
 private:
     uint32_t nCheckFrequency; //!< Value n means that n times in 2^32 we check.
+    unsigned int nClusterLimit; //!< Clusters of more transactions are linearized by ancestor feerate
     unsigned int nTransactionsUpdated; //!< Used by getblocktemplate to trigger CreateNewBlock() invocation
     CBlockPolicyEstimator* minerPolicyEstimator;
 
@@ -486,17 +504,57 @@ public:
 
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
+
+    /** A set of transactions of one cluster which is mined together, in a topologically valid order */
+    struct ClusterChunk {
+        std::vector<txiter> txs;
+        CAmount nModFees{0};
+        uint64_t nSize{0};
+        unsigned int nSigOps{0};
+    };
+    typedef std::vector<ClusterChunk> ClusterChunks;
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     struct TxLinks {
         setEntries parents;
         setEntries children;
+        uint64_t nClusterId{0};
     };
 
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    struct TxCluster {
+        setEntries txs;
+        //! Cached linearization of txs, split into chunks of non-increasing feerate. Empty when stale.
+        ClusterChunks chunks;
+    };
+    std::map<uint64_t, TxCluster> mapClusters;
+    //! Clusters which lost a transaction or a link and might have to be split into several clusters
+    std::set<uint64_t> setClustersToSplit;
+    uint64_t nNextClusterId;
+    uint64_t cachedClusterUsage; //!< dynamic memory usage of the cluster member sets and cached chunks
+
+    /**
+     * The address and spent indexes are not updated while a transaction enters or leaves the pool. Updates are
+     * queued instead and applied in order by FlushIndexQueue(), which runs periodically and before every lookup,
+     * so lookups see all transactions which were added before and don't block acceptance of new ones.
+     */
+    struct IndexUpdate
+    {
+        uint256 txhash;
+        bool fRemove{false};
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > addressDeltas;
+        std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentValues;
+
+        explicit IndexUpdate(const uint256& _txhash) : txhash(_txhash) {}
+    };
+    CCriticalSection cs_indexQueue;
+    std::vector<IndexUpdate> vIndexQueue; // protected by cs_indexQueue
+    std::atomic<bool> fIndexQueueUsed{false}; //!< whether any index update was queued, avoids queueing removals otherwise
+
+    CCriticalSection cs_index; //!< protects the maps below
     typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
     addressDeltaMap mapAddress;
 
@@ -518,8 +576,20 @@ private:
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
+    /** Move all transactions of the smaller of the two clusters into the larger one */
+    void MergeClusters(uint64_t nClusterIdA, uint64_t nClusterIdB);
+    /** Split every cluster in setClustersToSplit into its connected components */
+    void SplitClusters();
+    void InvalidateClusterChunks(TxCluster& cluster);
+    const ClusterChunks& GetCachedChunks(TxCluster& cluster);
+
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const;
 
+    void QueueIndexUpdate(IndexUpdate&& update);
+    void ApplyIndexQueue();
+    bool removeAddressIndex(const uint256 txhash);
+    bool removeSpentIndex(const uint256 txhash);
+
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx;
     std::map<uint256, CAmount> mapDeltas;
@@ -536,6 +606,7 @@ public:
      */
     void check(const CCoinsViewCache *pcoins) const;
     void setSanityCheck(double dFrequency = 1.0) { nCheckFrequency = dFrequency * 4294967295.0; }
+    void setClusterLimit(unsigned int nLimit) { LOCK(cs); nClusterLimit = nLimit; }
 
     // addUnchecked must updated state for all ancestors of a given transaction,
     // to track size/count of descendant transactions.  First version of
@@ -547,11 +618,12 @@ public:
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
-    bool removeAddressIndex(const uint256 txhash);
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool removeSpentIndex(const uint256 txhash);
+
+    /** Apply all queued updates of the address and spent indexes */
+    void FlushIndexQueue();
 
     void removeRecursive(const CTransaction &tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
@@ -615,6 +687,25 @@ public:
      */
     bool CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents = true) const;
 
+    /** Number of transactions in the cluster a transaction with the given
+     *  in-mempool ancestors would end up in, including the transaction itself. */
+    uint64_t CalculateClusterSize(const setEntries &setAncestors);
+
+    /** Append the chunks of every cluster to vClusters, one entry per cluster.
+     *  Transactions in setExclude are skipped; setExclude must be closed under
+     *  ancestors (e.g. the transactions already in a block), and clusters
+     *  touching it are linearized again without them.  Returns the number of
+     *  such clusters. */
+    int GetClusterChunks(std::vector<ClusterChunks>& vClusters, const setEntries& setExclude = setEntries());
+
+    /** Linearize a set of in-mempool transactions closed under ancestors
+     *  (relative to the rest of its cluster) and split the result into chunks.
+     *  Sets of more than nClusterLimit transactions use LinearizeByAncestorFee(). */
+    ClusterChunks LinearizeCluster(const std::vector<txiter>& vTxs) const;
+    /** Order vTxs by their mempool ancestor feerate, each transaction preceded by
+     *  its remaining ancestors within vTxs, in O(n log n) */
+    ClusterChunks LinearizeByAncestorFee(const std::vector<txiter>& vTxs) const;
+
     /** Populate setDescendants with all in-mempool descendants of hash.
      *  Assumes that setDescendants includes all in-mempool descendants of anything
      *  already in it.  */
@@ -13,11 +13,13 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinstats.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tokengroups.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "ctpl.h"
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
@@ -31,7 +33,9 @@
 #include "pow.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "recenttxcache.h"
 #include "reverse_iterator.h"
+#include "saltedhasher.h"
 #include "script/script.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
@@ -41,6 +45,7 @@
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
+#include "unordered_lru_cache.h"
 #include "util.h"
 #include "spork.h"
 #include "utilmoneystr.h"
@@ -99,6 +104,7 @@ bool fTxIndex = true;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fSpecialTxIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -234,6 +240,10 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewDB *pcoinsdbview = nullptr;
 CCoinsViewCache *pcoinsTip = nullptr;
+//! Rolling UTXO set statistics of pcoinsTip's best block, nullptr if unknown (protected by cs_main)
+static std::unique_ptr<CUTXOStats> pUTXOStatsTip;
+//! Transactions of the last blocks of chainActive (protected by cs_main)
+static CRecentTxCache recentTxCache(RECENT_TX_CACHE_BLOCKS, RECENT_TX_CACHE_MAX_USAGE);
 CBlockTreeDB *pblocktree = nullptr;
 CZerocoinDB *zerocoinDB = nullptr;
 CTokenDB *pTokenDB = nullptr;
@@ -762,6 +772,14 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false, errString);
         }
 
+        // Bound the cluster this transaction would join, so linearizing it stays cheap
+        size_t nLimitCluster = gArgs.GetArg("-limitclustercount", DEFAULT_CLUSTER_LIMIT);
+        uint64_t nClusterSize = pool.CalculateClusterSize(setAncestors);
+        if (nClusterSize > nLimitCluster) {
+            return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-cluster", false,
+                             strprintf("too many transactions in cluster [limit: %u]", nLimitCluster));
+        }
+
         // check special TXs after all the other checks. If we'd do this before the other checks, we might end up
         // DoS scoring a node for non-critical errors, e.g. duplicate keys because a TX is received that was already
         // mined
@@ -924,6 +942,10 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
         return true;
     }
 
+    if (recentTxCache.Get(hash, txOut, hashBlock)) {
+        return true;
+    }
+
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
@@ -1533,6 +1555,15 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        return error("%s: no undo data available", __func__);
+    }
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1575,11 +1606,48 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+/** Index erasures of disconnected blocks, collected so that a batch of blocks can be written in one go */
+struct DisconnectBatch {
+    std::vector<CTokenGroupID> tokenGroupIDs;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+};
+
+static bool WriteDisconnectBatch(const DisconnectBatch& batch)
+{
+    if (!pTokenDB->EraseTokenGroupBatch(batch.tokenGroupIDs)) {
+        return AbortNode("Failed to erase token group creations");
+    }
+
+    if (fSpentIndex) {
+        if (!pblocktree->UpdateSpentIndex(batch.spentIndex)) {
+            return AbortNode("Failed to delete spent index");
+        }
+    }
+
+    if (fAddressIndex) {
+        if (!pblocktree->EraseAddressIndex(batch.addressIndex)) {
+            return AbortNode("Failed to delete address index");
+        }
+        if (!pblocktree->UpdateAddressUnspentIndex(batch.addressUnspentIndex)) {
+            return AbortNode("Failed to write address unspent index");
+        }
+    }
+
+    return true;
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool fDisconnectTokens = true)
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  If pblockUndo is given, its undo data is used (and consumed) instead of reading it from disk.
+ *  If pbatch is given, index erasures are appended to it instead of being written immediately. */
+static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool fDisconnectTokens = true,
+                                        CBlockUndo* pblockUndo = nullptr, DisconnectBatch* pbatch = nullptr, CUTXOStats* pUTXOStats = nullptr)
 {
-    std::vector<CTokenGroupID> toRemoveTokenGroupIDs;
+    DisconnectBatch localBatch;
+    DisconnectBatch& batch = pbatch ? *pbatch : localBatch;
+    std::vector<CTokenGroupID>& toRemoveTokenGroupIDs = batch.tokenGroupIDs;
 
     bool fDIP0003Active = pindex->nHeight >= Params().GetConsensus().DIP0003Height;
     bool fHasBestBlock = evoDb->VerifyBestBlock(pindex->GetBlockHash());
@@ -1592,25 +1660,29 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
-        error("DisconnectBlock(): no undo data available");
-        return DISCONNECT_FAILED;
-    }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
-        error("DisconnectBlock(): failure reading undo data");
-        return DISCONNECT_FAILED;
+    CBlockUndo blockUndoRead;
+    if (!pblockUndo) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (pos.IsNull()) {
+            error("DisconnectBlock(): no undo data available");
+            return DISCONNECT_FAILED;
+        }
+        if (!UndoReadFromDisk(blockUndoRead, pos, pindex->pprev->GetBlockHash())) {
+            error("DisconnectBlock(): failure reading undo data");
+            return DISCONNECT_FAILED;
+        }
+        pblockUndo = &blockUndoRead;
     }
+    CBlockUndo& blockUndo = *pblockUndo;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("DisconnectBlock(): block and undo data inconsistent");
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex = batch.addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex = batch.addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& spentIndex = batch.spentIndex;
 
     if (!UndoSpecialTxsInBlock(block, pindex)) {
         return DISCONNECT_FAILED;
@@ -1668,6 +1740,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase || is_coinstake != coin.fCoinStake) {
                     fClean = false; // transaction output mismatch
                 }
+                if (is_spent && pUTXOStats) {
+                    pUTXOStats->RemoveCoin(out, coin);
+                }
             }
         }
 
@@ -1684,6 +1759,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
+                if (pUTXOStats) {
+                    pUTXOStats->AddCoin(out, view.AccessCoin(out));
+                }
 
                 const CTxIn input = tx.vin[j];
 
@@ -1733,30 +1811,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         }
     }
 
-    if (!pTokenDB->EraseTokenGroupBatch(toRemoveTokenGroupIDs)) {
-        AbortNode("Failed to erase token group creations");
-        return DISCONNECT_FAILED;
-    }
-
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode("Failed to delete spent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
+    if (!pbatch && !WriteDisconnectBatch(localBatch)) {
+        return DISCONNECT_FAILED;
     }
 
     evoDb->WriteBestBlock(pindex->pprev->GetBlockHash());
@@ -1912,11 +1971,30 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+/** Apply the coins created and spent by a connected block to the rolling UTXO set statistics */
+static void UpdateUTXOStats(const CBlock& block, const CBlockUndo& blockundo, int nHeight, CUTXOStats& stats)
+{
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
+                stats.AddCoin(COutPoint(tx.GetHash(), o), Coin(tx.vout[o], nHeight, tx.IsCoinBase(), tx.IsCoinStake()));
+            }
+        }
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < txundo.vprevout.size() && j < tx.vin.size(); j++) {
+                stats.RemoveCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+            }
+        }
+    }
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, CUTXOStats* pUTXOStats = nullptr)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2379,6 +2457,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     if (fJustCheck)
         return true;
 
+    // Keep the mints of this block around for the accumulator checkpoints of the next blocks
+    CacheBlockPubcoins(block, pindex);
+
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS))
     {
@@ -2465,6 +2546,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
+    if (pUTXOStats) {
+        UpdateUTXOStats(block, blockundo, pindex->nHeight, *pUTXOStats);
+    }
+
     int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5;
     LogPrint(BCLog::BENCHMARK, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeIndex * 0.000001);
 
@@ -2671,6 +2756,24 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     LogPrintf("%s\n", strMessage);
 }
 
+/** Replace the rolling UTXO set statistics after pcoinsTip moved to hashBlock, nullptr if they are unknown */
+static void SetUTXOStatsTip(std::unique_ptr<CUTXOStats> pstats, const uint256& hashBlock)
+{
+    AssertLockHeld(cs_main);
+    if (pstats) {
+        pstats->hashBlock = hashBlock;
+    }
+    pUTXOStatsTip = std::move(pstats);
+    pcoinsdbview->SetPendingUTXOStats(pUTXOStatsTip.get());
+}
+
+/** Copy of the rolling UTXO set statistics of the tip to be updated by the next block */
+static std::unique_ptr<CUTXOStats> CopyUTXOStatsTip()
+{
+    AssertLockHeld(cs_main);
+    return std::unique_ptr<CUTXOStats>(pUTXOStatsTip ? new CUTXOStats(*pUTXOStatsTip) : nullptr);
+}
+
 /** Disconnect chainActive's tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
@@ -2697,11 +2800,13 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 
         CCoinsViewCache view(pcoinsTip);
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        std::unique_ptr<CUTXOStats> pstatsNew = CopyUTXOStatsTip();
+        if (DisconnectBlock(block, pindexDelete, view, true, nullptr, nullptr, pstatsNew.get()) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
+        SetUTXOStatsTip(std::move(pstatsNew), pindexDelete->pprev->GetBlockHash());
     }
     LogPrint(BCLog::BENCHMARK, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
@@ -2721,6 +2826,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         }
     }
 
+    recentTxCache.RemoveBlock(pindexDelete->GetBlockHash());
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev, chainparams);
     // Let wallets know transactions went from 1-confirmed to
@@ -2729,6 +2835,109 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     return true;
 }
 
+/**
+ * Disconnect up to MAX_DISCONNECT_BATCH_BLOCKS blocks from chainActive's tip towards pindexFork as one batch.
+ * Block and undo data of the whole range is prefetched in parallel, the blocks are undone inside a single evodb
+ * transaction and coins view, and the index erasures of all blocks are written at once. Mempool handling, tip
+ * updates and notifications happen per block, exactly like in DisconnectTip.
+ */
+static bool DisconnectTipsBatched(CValidationState& state, const CChainParams& chainparams, const CBlockIndex* pindexFork, DisconnectedBlockTransactions *disconnectpool)
+{
+    std::vector<CBlockIndex*> vpindexDelete;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork && vpindexDelete.size() < MAX_DISCONNECT_BATCH_BLOCKS; pindex = pindex->pprev) {
+        vpindexDelete.push_back(pindex);
+    }
+    assert(!vpindexDelete.empty());
+
+    // Prefetch blocks and undo data of the whole range
+    int64_t nStart = GetTimeMicros();
+    const size_t nBlocks = vpindexDelete.size();
+    std::vector<std::shared_ptr<CBlock> > vblocks(nBlocks);
+    std::vector<CBlockUndo> vblockUndos(nBlocks);
+    std::vector<std::string> vReadErrors(nBlocks);
+    const size_t nThreads = std::min<size_t>(nBlocks, std::max(1, GetNumCores()));
+    auto prefetch = [&](size_t nThread) {
+        for (size_t i = nThread; i < nBlocks; i += nThreads) {
+            const CBlockIndex* pindex = vpindexDelete[i];
+            vblocks[i] = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*vblocks[i], pindex, chainparams.GetConsensus())) {
+                vReadErrors[i] = "Failed to read block";
+                continue;
+            }
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (pos.IsNull()) {
+                vReadErrors[i] = "no undo data available";
+            } else if (!UndoReadFromDisk(vblockUndos[i], pos, pindex->pprev->GetBlockHash())) {
+                vReadErrors[i] = "failure reading undo data";
+            }
+        }
+    };
+    std::vector<std::thread> vThreads;
+    for (size_t i = 1; i < nThreads; i++) {
+        vThreads.emplace_back(prefetch, i);
+    }
+    prefetch(0);
+    for (auto& t : vThreads) {
+        t.join();
+    }
+    for (size_t i = 0; i < nBlocks; i++) {
+        if (!vReadErrors[i].empty()) {
+            return AbortNode(state, strprintf("DisconnectTipsBatched(): %s for block %s", vReadErrors[i], vpindexDelete[i]->GetBlockHash().ToString()));
+        }
+    }
+    int64_t nTimePrefetch = GetTimeMicros();
+    LogPrint(BCLog::BENCHMARK, "- Prefetch %u blocks for disconnect: %.2fms\n", nBlocks, (nTimePrefetch - nStart) * 0.001);
+
+    // Apply all blocks atomically to the chain state.
+    {
+        auto dbTx = evoDb->BeginTransaction();
+
+        CCoinsViewCache view(pcoinsTip);
+        DisconnectBatch batch;
+        std::unique_ptr<CUTXOStats> pstatsNew = CopyUTXOStatsTip();
+        for (size_t i = 0; i < nBlocks; i++) {
+            assert(view.GetBestBlock() == vpindexDelete[i]->GetBlockHash());
+            if (DisconnectBlock(*vblocks[i], vpindexDelete[i], view, true, &vblockUndos[i], &batch, pstatsNew.get()) != DISCONNECT_OK)
+                return error("DisconnectTipsBatched(): DisconnectBlock %s failed", vpindexDelete[i]->GetBlockHash().ToString());
+        }
+        if (!WriteDisconnectBatch(batch))
+            return false;
+        bool flushed = view.Flush();
+        assert(flushed);
+        dbTx->Commit();
+        SetUTXOStatsTip(std::move(pstatsNew), vpindexDelete.back()->pprev->GetBlockHash());
+    }
+    LogPrint(BCLog::BENCHMARK, "- Disconnect %u blocks: %.2fms\n", nBlocks, (GetTimeMicros() - nTimePrefetch) * 0.001);
+    // Write the chain state to disk, if necessary.
+    if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED))
+        return false;
+
+    for (size_t i = 0; i < nBlocks; i++) {
+        const std::shared_ptr<CBlock>& pblock = vblocks[i];
+        CBlockIndex* pindexDelete = vpindexDelete[i];
+        if (disconnectpool) {
+            // Save transactions to re-add to mempool at end of reorg
+            for (auto it = pblock->vtx.rbegin(); it != pblock->vtx.rend(); ++it) {
+                disconnectpool->addTransaction(*it);
+            }
+            while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
+                // Drop the earliest entry, and remove its children from the mempool.
+                auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
+                mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
+                disconnectpool->removeEntry(it);
+            }
+        }
+
+        recentTxCache.RemoveBlock(pindexDelete->GetBlockHash());
+        // Update chainActive and related variables.
+        UpdateTip(pindexDelete->pprev, chainparams);
+        // Let wallets know transactions went from 1-confirmed to
+        // 0-confirmed or conflicted:
+        GetMainSignals().BlockDisconnected(pblock, pindexDelete);
+    }
+    return true;
+}
+
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
@@ -2829,7 +3038,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         auto dbTx = evoDb->BeginTransaction();
 
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        std::unique_ptr<CUTXOStats> pstatsNew = CopyUTXOStatsTip();
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, pstatsNew.get());
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2841,6 +3051,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
+        SetUTXOStatsTip(std::move(pstatsNew), pindexNew->GetBlockHash());
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
@@ -2852,6 +3063,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Remove conflicting transactions from the mempool.;
     mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
     disconnectpool.removeForBlock(blockConnecting.vtx);
+    recentTxCache.AddBlock(blockConnecting, pindexNew->GetBlockHash());
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
 
@@ -2947,7 +3159,7 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state, chainparams, &disconnectpool)) {
+        if (!DisconnectTipsBatched(state, chainparams, pindexFork, &disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             UpdateMempoolForReorg(disconnectpool, false);
@@ -3461,6 +3673,72 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     return true;
 }
 
+/**
+ * Runs CheckTransaction over all transactions of a block and counts their legacy sigops. Blocks with at least
+ * CHECKBLOCK_PARALLEL_MIN_TXS transactions are split into one contiguous range per script check thread. On
+ * failure, state is the one of the first failing transaction in block order, like in a sequential check.
+ */
+static bool CheckBlockTransactions(const CBlock& block, CValidationState& state, bool fZerocoinActive, unsigned int& nSigOpsRet)
+{
+    struct RangeResult {
+        size_t nFailedTx;
+        CValidationState state;
+        unsigned int nSigOps{0};
+    };
+    auto checkRange = [&block, fZerocoinActive](size_t nBegin, size_t nEnd) {
+        RangeResult result;
+        result.nFailedTx = block.vtx.size();
+        for (size_t i = nBegin; i < nEnd; i++) {
+            const CTransaction& tx = *block.vtx[i];
+            if (!CheckTransaction(tx, result.state, fZerocoinActive)) {
+                result.nFailedTx = i;
+                break;
+            }
+            result.nSigOps += GetLegacySigOpCount(tx);
+        }
+        return result;
+    };
+
+    const size_t nTxs = block.vtx.size();
+    std::vector<RangeResult> vResults;
+    if (nScriptCheckThreads == 0 || nTxs < CHECKBLOCK_PARALLEL_MIN_TXS) {
+        vResults.emplace_back(checkRange(0, nTxs));
+    } else {
+        static CCriticalSection cs_pool;
+        static std::unique_ptr<ctpl::thread_pool> workerPool;
+        {
+            LOCK(cs_pool);
+            if (!workerPool) {
+                workerPool.reset(new ctpl::thread_pool(nScriptCheckThreads - 1));
+                RenameThreadPool(*workerPool, "ion-blkcheck");
+            }
+        }
+
+        const size_t nRanges = nScriptCheckThreads;
+        const size_t nRangeSize = (nTxs + nRanges - 1) / nRanges;
+        std::vector<std::future<RangeResult> > vFutures;
+        for (size_t nBegin = nRangeSize; nBegin < nTxs; nBegin += nRangeSize) {
+            const size_t nEnd = std::min(nTxs, nBegin + nRangeSize);
+            vFutures.emplace_back(workerPool->push([&checkRange, nBegin, nEnd](int) { return checkRange(nBegin, nEnd); }));
+        }
+        vResults.emplace_back(checkRange(0, std::min(nTxs, nRangeSize)));
+        for (auto& f : vFutures) {
+            vResults.emplace_back(f.get());
+        }
+    }
+
+    nSigOpsRet = 0;
+    for (const auto& result : vResults) {
+        if (result.nFailedTx != nTxs) {
+            state = result.state;
+            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                 strprintf("Transaction check failed (tx hash %s) %s", block.vtx[result.nFailedTx]->GetHash().ToString(), state.GetDebugMessage()));
+        }
+        nSigOpsRet += result.nSigOps;
+    }
+    return true;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
 {
     // These are checks that are independent of context.
@@ -3515,21 +3793,33 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
                 return state.DoS(100, error("CheckBlock() : more than one coinstake"));
     }
 
-    // Check transactions
-    bool fZerocoinActive = block.GetBlockTime() > consensusParams.nZerocoinStartTime;
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, fZerocoinActive))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+    // The transactions of a block with a verified merkle root are fully determined by its hash, so their
+    // context-free checks only have to pass once per block hash, no matter which CBlock copy is checked
+    static CCriticalSection cs_checkedTxs;
+    static unordered_lru_cache<uint256, bool, StaticSaltedHasher, CHECKBLOCK_CACHE_SIZE> checkedTxsCache;
+    const uint256 hashBlock = block.GetHash();
+    bool fTxsChecked = false;
+    if (fCheckMerkleRoot) {
+        LOCK(cs_checkedTxs);
+        fTxsChecked = checkedTxsCache.exists(hashBlock);
+    }
 
-    unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
+    if (!fTxsChecked) {
+        // Check transactions
+        bool fZerocoinActive = block.GetBlockTime() > consensusParams.nZerocoinStartTime;
+        unsigned int nSigOps = 0;
+        if (!CheckBlockTransactions(block, state, fZerocoinActive, nSigOps))
+            return false;
+
+        // sigops limits (relaxed)
+        if (nSigOps > MaxBlockSigOps(true))
+            return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
+
+        if (fCheckMerkleRoot) {
+            LOCK(cs_checkedTxs);
+            checkedTxsCache.insert(hashBlock, true);
+        }
     }
-    // sigops limits (relaxed)
-    if (nSigOps > MaxBlockSigOps(true))
-        return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
 
     if (fCheckPOW && fCheckMerkleRoot)
         block.fChecked = true;
@@ -4233,6 +4523,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a special tx index
+    pblocktree->ReadFlag("specialtxindex", fSpecialTxIndex);
+    LogPrintf("%s: special tx index %s\n", __func__, fSpecialTxIndex ? "enabled" : "disabled");
+
     return true;
 }
 
@@ -4458,6 +4752,54 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     return true;
 }
 
+bool LoadUTXOStats()
+{
+    LOCK(cs_main);
+    std::unique_ptr<CUTXOStats> pstats(new CUTXOStats());
+    const uint256 hashBestBlock = pcoinsTip->GetBestBlock();
+    if (pcoinsdbview->ReadUTXOStats(*pstats) && pstats->hashBlock == hashBestBlock) {
+        SetUTXOStatsTip(std::move(pstats), hashBestBlock);
+        return true;
+    }
+
+    // Missing (older database, replayed blocks) or stale, walk the coins database once
+    pstats.reset(new CUTXOStats());
+    if (!hashBestBlock.IsNull()) {
+        LogPrintf("%s: computing UTXO set statistics at %s...\n", __func__, hashBestBlock.ToString());
+        int64_t nStart = GetTimeMillis();
+        std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+        assert(pcursor->GetBestBlock() == hashBestBlock);
+        for (; pcursor->Valid(); pcursor->Next()) {
+            if (ShutdownRequested()) {
+                return false;
+            }
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+                return error("%s: unable to read value", __func__);
+            }
+            pstats->AddCoin(key, coin);
+        }
+        pstats->hashBlock = hashBestBlock;
+        if (!pcoinsdbview->WriteUTXOStats(*pstats)) {
+            return error("%s: failed to write UTXO set statistics", __func__);
+        }
+        LogPrintf("%s: computed statistics of %u transaction outputs in %dms\n", __func__, pstats->nTransactionOutputs, GetTimeMillis() - nStart);
+    }
+    SetUTXOStatsTip(std::move(pstats), hashBestBlock);
+    return true;
+}
+
+bool GetUTXOStatsTip(CUTXOStats& stats)
+{
+    LOCK(cs_main);
+    if (!pUTXOStatsTip) {
+        return false;
+    }
+    stats = *pUTXOStatsTip;
+    return true;
+}
+
 
 // May NOT be used after any connections are up as much
 // of the peer-processing logic assumes a consistent
@@ -4465,6 +4807,8 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    pUTXOStatsTip.reset();
+    recentTxCache.Clear();
     setBlockIndexCandidates.clear();
     chainActive.SetTip(nullptr);
     pindexBestInvalid = nullptr;
@@ -4522,6 +4866,10 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // Use the provided setting for -spentindex in the new database
         fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
         pblocktree->WriteFlag("spentindex", fSpentIndex);
+
+        // Use the provided setting for -specialtxindex in the new database
+        fSpecialTxIndex = gArgs.GetBoolArg("-specialtxindex", DEFAULT_SPECIALTXINDEX);
+        pblocktree->WriteFlag("specialtxindex", fSpecialTxIndex);
     }
     return true;
 }
@@ -4574,21 +4922,114 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return true;
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+/**
+ * Pipeline used by LoadExternalBlockFile. A scanner thread locates and deserializes the blocks in the file, a pool of
+ * parser threads hashes them and runs the context-free checks (X11 hash and merkle root), and the importing thread
+ * consumes the parsed blocks in file order from a bounded queue. The scanner resumes right after the magic bytes of a
+ * block which can't be deserialized, like the serial import did, so that valid blocks inside it aren't lost.
+ */
+class CBlockFileImporter
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+public:
+    struct ParsedBlock
+    {
+        uint64_t nBlockPos{0};
+        std::shared_ptr<CBlock> pblock;
+        uint256 hash;
+        std::string strError;
+    };
 
-    int nLoaded = 0;
-    try {
+private:
+    const CChainParams& chainparams;
+    CBufferedFile& blkdat;
+    ctpl::thread_pool parserPool;
+    std::thread scannerThread;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::future<ParsedBlock> > queue;
+    size_t nMaxQueueSize;
+    bool fScanDone{false};
+    bool fStop{false};
+
+public:
+    std::atomic<int64_t> nTimeScan{0};
+    std::atomic<int64_t> nTimeParse{0};
+    std::atomic<uint64_t> nBlocksScanned{0};
+    std::atomic<uint64_t> nBytesScanned{0};
+
+    CBlockFileImporter(const CChainParams& _chainparams, CBufferedFile& _blkdat, int nParserThreads) :
+        chainparams(_chainparams),
+        blkdat(_blkdat),
+        parserPool(nParserThreads),
+        nMaxQueueSize(nParserThreads * 4)
+    {
+        RenameThreadPool(parserPool, "ion-blkparse");
+        scannerThread = std::thread(&TraceThread<std::function<void()> >, "blkscan", std::function<void()>(std::bind(&CBlockFileImporter::ThreadScan, this)));
+    }
+
+    ~CBlockFileImporter()
+    {
+        Stop();
+        scannerThread.join();
+        parserPool.stop(true);
+    }
+
+    void Stop()
+    {
+        std::unique_lock<std::mutex> l(cs);
+        fStop = true;
+        cond.notify_all();
+    }
+
+    int GetParserThreads() { return parserPool.size(); }
+
+    /** Returns the next parsed block in file order, or false when the file is exhausted */
+    bool Next(ParsedBlock& ret)
+    {
+        std::future<ParsedBlock> f;
+        {
+            std::unique_lock<std::mutex> l(cs);
+            while (queue.empty() && !fScanDone) {
+                cond.wait_for(l, std::chrono::milliseconds(100));
+                l.unlock();
+                boost::this_thread::interruption_point();
+                l.lock();
+            }
+            if (queue.empty()) {
+                return false;
+            }
+            f = std::move(queue.front());
+            queue.pop_front();
+            cond.notify_all();
+        }
+        ret = f.get();
+        return true;
+    }
+
+private:
+    void Push(std::future<ParsedBlock>&& f)
+    {
+        std::unique_lock<std::mutex> l(cs);
+        while (queue.size() >= nMaxQueueSize && !fStop) {
+            cond.wait(l);
+        }
+        queue.emplace_back(std::move(f));
+        cond.notify_all();
+    }
+
+    bool IsStopped()
+    {
+        std::unique_lock<std::mutex> l(cs);
+        return fStop;
+    }
+
+    void ThreadScan()
+    {
         unsigned int nMaxBlockSize = MaxBlockSize(true);
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
+        int64_t nTimeStart = GetTimeMicros();
+        while (!blkdat.eof() && !IsStopped()) {
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
@@ -4610,19 +5051,83 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 break;
             }
             try {
-                // read block
+                // deserialize the block here, so that a corrupt one is rescanned from right after its magic bytes
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
+                auto pblock = std::make_shared<CBlock>();
+                blkdat >> *pblock;
                 nRewind = blkdat.GetPos();
+                nBlocksScanned++;
+                nBytesScanned += nSize;
+
+                nTimeScan += GetTimeMicros() - nTimeStart;
+                Push(parserPool.push([this, nBlockPos, pblock](int threadId) {
+                    return ParseBlock(nBlockPos, pblock);
+                }));
+                nTimeStart = GetTimeMicros();
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+        nTimeScan += GetTimeMicros() - nTimeStart;
+
+        std::unique_lock<std::mutex> l(cs);
+        fScanDone = true;
+        cond.notify_all();
+    }
+
+    ParsedBlock ParseBlock(uint64_t nBlockPos, const std::shared_ptr<CBlock>& pblock)
+    {
+        int64_t nTimeStart = GetTimeMicros();
+        ParsedBlock ret;
+        ret.nBlockPos = nBlockPos;
+        try {
+            ret.pblock = pblock;
+            ret.hash = ret.pblock->GetHash();
+
+            // Warm up the context-free checks so that AcceptBlock finds the block already checked. Failures are
+            // not final here, AcceptBlock re-runs the checks and marks the block as invalid
+            CValidationState dummy;
+            CheckBlock(*ret.pblock, dummy, chainparams.GetConsensus());
+        } catch (const std::exception& e) {
+            ret.pblock.reset();
+            ret.strError = e.what();
+        }
+        nTimeParse += GetTimeMicros() - nTimeStart;
+        return ret;
+    }
+};
+
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+{
+    // Map of disk positions for blocks with unknown parent (only used for reindex)
+    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    int64_t nStart = GetTimeMillis();
+    int64_t nTimeValidate = 0;
+
+    int nLoaded = 0;
+    try {
+        unsigned int nMaxBlockSize = MaxBlockSize(true);
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
+        CBlockFileImporter importer(chainparams, blkdat, std::max(1, std::min(GetNumCores() - 1, MAX_BLOCKFILE_PARSER_THREADS)));
+        CBlockFileImporter::ParsedBlock parsed;
+        while (importer.Next(parsed)) {
+            boost::this_thread::interruption_point();
+
+            if (!parsed.pblock) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, parsed.strError);
+                continue;
+            }
+            int64_t nTimeStart = GetTimeMicros();
+            try {
+                if (dbp)
+                    dbp->nPos = parsed.nBlockPos;
+                std::shared_ptr<CBlock> pblock = parsed.pblock;
+                const CBlock& block = *pblock;
 
                 // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
+                const uint256& hash = parsed.hash;
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
                     LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                             block.hashPrevBlock.ToString());
@@ -4683,7 +5188,17 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            nTimeValidate += GetTimeMicros() - nTimeStart;
         }
+        importer.Stop();
+
+        double nMBytes = importer.nBytesScanned / 1000000.0;
+        LogPrint(BCLog::REINDEX, "%s: scan: %u blocks, %.2fMB in %.2fs (%.2fMB/s)\n", __func__,
+                 (unsigned int)importer.nBlocksScanned, nMBytes, importer.nTimeScan * 0.000001, nMBytes / std::max(importer.nTimeScan * 0.000001, 0.000001));
+        LogPrint(BCLog::REINDEX, "%s: parse: %.2fs on %d threads (%.2f blocks/s per thread)\n", __func__,
+                 importer.nTimeParse * 0.000001, importer.GetParserThreads(), importer.nBlocksScanned / std::max(importer.nTimeParse * 0.000001, 0.000001));
+        LogPrint(BCLog::REINDEX, "%s: validate: %d blocks in %.2fs (%.2f blocks/s)\n", __func__,
+                 nLoaded, nTimeValidate * 0.000001, nLoaded / std::max(nTimeValidate * 0.000001, 0.000001));
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
@@ -528,6 +528,35 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(), 500*COIN);
 }
 
+BOOST_FIXTURE_TEST_CASE(FilterBlockTransactions, TestChain100Setup)
+{
+    CWallet wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    }
+
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbaseTxns.back()));
+
+    // Spends an output of the wallet's coinbase which isn't in the wallet yet
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns.back().GetHash(), 0));
+    spend.vout.emplace_back(1 * COIN, GetScriptForRawPubKey(otherKey.GetPubKey()));
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    CMutableTransaction unrelated;
+    unrelated.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    unrelated.vout.emplace_back(1 * COIN, GetScriptForRawPubKey(otherKey.GetPubKey()));
+    block.vtx.push_back(MakeTransactionRef(unrelated));
+
+    std::vector<bool> vfRelevant = wallet.FilterBlockTransactions(block);
+    BOOST_CHECK(vfRelevant == std::vector<bool>({true, true, false}));
+}
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -14,6 +14,7 @@
 #include "wallet/coincontrol.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "ctpl.h"
 #include "fs.h"
 #include "init.h"
 #include "key.h"
@@ -47,11 +48,80 @@
 #include "llmq/quorums_chainlocks.h"
 
 #include <assert.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
 
 std::vector<CWalletRef> vpwallets;
+
+/**
+ * IsMine pre-filter for connected blocks, shared by all loaded wallets.
+ *
+ * With more than one wallet loaded, the first wallet notified about a block
+ * filters it for every wallet concurrently on a worker pool. Each wallet then
+ * only syncs the transactions relevant to it, still in notification order.
+ */
+class CWalletBlockFilter
+{
+private:
+    CCriticalSection cs;
+    std::unique_ptr<ctpl::thread_pool> workerPool;
+    uint256 hashBlock;
+    std::map<const CWallet*, std::vector<bool> > mapRelevantTxs;
+
+public:
+    //! Returns false if the block was not pre-filtered for pwallet
+    bool GetRelevantTxs(const CWallet* pwallet, const CBlockIndex* pindex, const CBlock& block, std::vector<bool>& vfRelevantRet);
+};
+
+bool CWalletBlockFilter::GetRelevantTxs(const CWallet* pwallet, const CBlockIndex* pindex, const CBlock& block, std::vector<bool>& vfRelevantRet)
+{
+    LOCK(cs);
+    if (pindex->GetBlockHash() != hashBlock) {
+        hashBlock = pindex->GetBlockHash();
+        mapRelevantTxs.clear();
+        if (vpwallets.size() < 2) {
+            return false;
+        }
+
+        if (!workerPool) {
+            workerPool.reset(new ctpl::thread_pool(std::max(1, std::min((int)vpwallets.size(), GetNumCores()))));
+            RenameThreadPool(*workerPool, "ion-walletfilter");
+        }
+        std::vector<std::future<std::vector<bool> > > vFutures;
+        for (const CWalletRef pw : vpwallets) {
+            vFutures.emplace_back(workerPool->push([pw, &block](int) {
+                try {
+                    return pw->FilterBlockTransactions(block);
+                } catch (const std::exception& e) {
+                    // Let this wallet check every transaction itself
+                    LogPrintf("CWalletBlockFilter::%s -- %s: %s\n", __func__, pw->GetName(), e.what());
+                    return std::vector<bool>();
+                }
+            }));
+        }
+        for (size_t i = 0; i < vpwallets.size(); i++) {
+            std::vector<bool> vfRelevant = vFutures[i].get();
+            if (vfRelevant.size() == block.vtx.size()) {
+                mapRelevantTxs.emplace(vpwallets[i], std::move(vfRelevant));
+            }
+        }
+    }
+
+    auto it = mapRelevantTxs.find(pwallet);
+    if (it == mapRelevantTxs.end()) {
+        return false;
+    }
+    vfRelevantRet = std::move(it->second);
+    mapRelevantTxs.erase(it);
+    return true;
+}
+
+static CWalletBlockFilter walletBlockFilter;
 /** Transaction fee set by the user */
 CFeeRate payTxFee(DEFAULT_TRANSACTION_FEE);
 unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
@@ -246,6 +316,116 @@ void CWallet::DeriveNewChildKey(CWalletDB &walletdb, const CKeyMetadata& metadat
         throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
 }
 
+/**
+ * Derives the children nStart .. nStart + nCount - 1 of extKeyParent, together
+ * with their public keys. Large batches are split across threads.
+ */
+static void DeriveChildExtKeys(const CExtKey& extKeyParent, uint32_t nStart, unsigned int nCount, std::vector<std::pair<CExtKey, CPubKey> >& vKeysRet)
+{
+    vKeysRet.assign(nCount, std::make_pair(CExtKey(), CPubKey()));
+    auto deriveKey = [&](unsigned int i) {
+        CExtKey& childKey = vKeysRet[i].first;
+        extKeyParent.Derive(childKey, nStart + i);
+        CPubKey pubkey = childKey.key.GetPubKey();
+        assert(childKey.key.VerifyPubKey(pubkey));
+        vKeysRet[i].second = pubkey;
+    };
+
+    unsigned int nThreads = 1;
+    if (nCount >= PARALLEL_KEY_DERIVATION_MIN_KEYS) {
+        nThreads = std::max(1, std::min(GetNumCores(), (int)(nCount / (PARALLEL_KEY_DERIVATION_MIN_KEYS / 2))));
+    }
+    if (nThreads <= 1) {
+        for (unsigned int i = 0; i < nCount; i++) {
+            deriveKey(i);
+        }
+        return;
+    }
+
+    std::atomic<unsigned int> nNextKey(0);
+    std::vector<std::thread> vThreads;
+    for (unsigned int i = 0; i < nThreads; i++) {
+        vThreads.emplace_back([&]() {
+            for (unsigned int nKey = nNextKey++; nKey < nCount; nKey = nNextKey++) {
+                deriveKey(nKey);
+            }
+        });
+    }
+    for (auto& thread : vThreads) {
+        thread.join();
+    }
+}
+
+void CWallet::DeriveNewChildKeys(CWalletDB &walletdb, const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, unsigned int nCount, std::vector<CPubKey>& vPubKeysRet)
+{
+    AssertLockHeld(cs_wallet);
+    vPubKeysRet.clear();
+    if (nCount == 0)
+        return;
+
+    CHDChain hdChainTmp;
+    if (!GetHDChain(hdChainTmp)) {
+        throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
+    }
+
+    if (!DecryptHDChain(hdChainTmp))
+        throw std::runtime_error(std::string(__func__) + ": DecryptHDChainSeed failed");
+    // make sure seed matches this chain
+    if (hdChainTmp.GetID() != hdChainTmp.GetSeedHash())
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
+
+    CHDAccount acc;
+    if (!hdChainTmp.GetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
+
+    // the hardened part of the keypath is the same for all keys, derive it only once
+    CExtKey changeKey;
+    hdChainTmp.DeriveChangeExtKey(nAccountIndex, fInternal, changeKey);
+
+    // derive child keys starting at the next index, skip keys already known to the wallet
+    uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
+    std::vector<std::pair<CExtKey, CPubKey> > vChildKeys;
+    while (vPubKeysRet.size() < nCount) {
+        DeriveChildExtKeys(changeKey, nChildIndex, nCount - vPubKeysRet.size(), vChildKeys);
+        for (const auto& childKey : vChildKeys) {
+            nChildIndex++;
+            const CPubKey& pubkey = childKey.second;
+            if (HaveKey(pubkey.GetID()))
+                continue;
+
+            // store metadata
+            mapKeyMetadata[pubkey.GetID()] = metadata;
+            if (!AddHDPubKey(walletdb, childKey.first.Neuter(), fInternal))
+                throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
+            vPubKeysRet.push_back(pubkey);
+        }
+    }
+    UpdateTimeFirstKey(metadata.nCreateTime);
+
+    // update the chain model in the database once for all new keys
+    CHDChain hdChainCurrent;
+    GetHDChain(hdChainCurrent);
+
+    if (fInternal) {
+        acc.nInternalChainCounter = nChildIndex;
+    }
+    else {
+        acc.nExternalChainCounter = nChildIndex;
+    }
+
+    if (!hdChainCurrent.SetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": SetAccount failed");
+
+    if (IsCrypted()) {
+        if (!SetCryptedHDChain(walletdb, hdChainCurrent, false))
+            throw std::runtime_error(std::string(__func__) + ": SetCryptedHDChain failed");
+    }
+    else {
+        if (!SetHDChain(walletdb, hdChainCurrent, false))
+            throw std::runtime_error(std::string(__func__) + ": SetHDChain failed");
+    }
+}
+
 bool CWallet::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
 {
     LOCK(cs_wallet);
@@ -794,6 +974,18 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 }
 
 
+void CWallet::AddToGroupedOutputs(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+        CTokenGroupID grpID = GetTokenGroup(wtx.tx->vout[i].scriptPubKey);
+        if (grpID != NoGroup) {
+            mapGroupedOutputs[grpID].insert(COutPoint(hash, i));
+        }
+    }
+}
+
 void CWallet::AddToSpends(const uint256& wtxid)
 {
     assert(mapWallet.count(wtxid));
@@ -1121,6 +1313,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         wtx.nTimeSmart = ComputeTimeSmart(wtx);
         AddToSpends(hash);
+        AddToGroupedOutputs(wtx);
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
@@ -1198,6 +1391,7 @@ bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
     wtx.BindWallet(this);
     wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
     AddToSpends(hash);
+    AddToGroupedOutputs(wtx);
     for (const CTxIn& txin : wtx.tx->vin) {
         if (mapWallet.count(txin.prevout.hash)) {
             CWalletTx& prevtx = mapWallet[txin.prevout.hash];
@@ -1435,7 +1629,32 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcc
     SyncTransaction(ptx);
 }
 
+std::vector<bool> CWallet::FilterBlockTransactions(const CBlock& block) const
+{
+    LOCK(cs_wallet);
+    std::vector<bool> vfRelevant(block.vtx.size(), false);
+    // Transactions of this block which SyncTransaction may add to the wallet
+    std::set<uint256> setRelevantTxs;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        bool fRelevant = mapWallet.count(tx.GetHash()) || IsMine(tx) || IsFromMe(tx);
+        for (size_t j = 0; j < tx.vin.size() && !fRelevant; j++) {
+            // Spends from an earlier relevant transaction or conflicts with a wallet transaction
+            fRelevant = setRelevantTxs.count(tx.vin[j].prevout.hash) || mapTxSpends.count(tx.vin[j].prevout);
+        }
+        if (fRelevant) {
+            vfRelevant[i] = true;
+            setRelevantTxs.insert(tx.GetHash());
+        }
+    }
+    return vfRelevant;
+}
+
 void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) {
+    // Must be called before taking cs_wallet, the filter locks the wallets on its own threads
+    std::vector<bool> vfRelevant;
+    bool fFiltered = walletBlockFilter.GetRelevantTxs(this, pindex, *pblock, vfRelevant);
+
     LOCK2(cs_main, cs_wallet);
     // TODO: Temporarily ensure that mempool removals are notified before
     // connected transactions.  This shouldn't matter, but the abandoned
@@ -1448,8 +1667,16 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     for (const CTransactionRef& ptx : vtxConflicted) {
         SyncTransaction(ptx);
     }
+    size_t nKeys = mapKeyMetadata.size();
     for (size_t i = 0; i < pblock->vtx.size(); i++) {
+        if (fFiltered && !vfRelevant[i]) {
+            continue;
+        }
         SyncTransaction(pblock->vtx[i], pindex, i);
+        // Keys added by a keypool top-up may be used by later transactions the filter didn't see
+        if (fFiltered && mapKeyMetadata.size() != nKeys) {
+            fFiltered = false;
+        }
     }
 
     // The GUI expects a NotifyTransactionChanged when a coinbase tx
@@ -2139,6 +2366,16 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
         double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+        // Read the next block from disk while the current one is scanned
+        auto readBlock = [&chainParams](const CBlockIndex* pindexRead) {
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblock, pindexRead, chainParams.GetConsensus()))
+                pblock.reset();
+            return pblock;
+        };
+        std::future<std::shared_ptr<CBlock> > nextBlock;
+        if (pindex)
+            nextBlock = std::async(std::launch::async, readBlock, pindex);
         while (pindex && !fAbortRescan)
         {
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
@@ -2148,16 +2385,21 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+            std::shared_ptr<CBlock> pblock = nextBlock.get();
+            CBlockIndex* pindexNext = chainActive.Next(pindex);
+            if (pindexNext)
+                nextBlock = std::async(std::launch::async, readBlock, pindexNext);
+            if (pblock) {
+                for (size_t posInBlock = 0; posInBlock < pblock->vtx.size(); ++posInBlock) {
+                    AddToWalletIfInvolvingMe(pblock->vtx[posInBlock], pindex, posInBlock, fUpdate);
                 }
             } else {
                 ret = pindex;
             }
-            pindex = chainActive.Next(pindex);
+            pindex = pindexNext;
         }
+        if (nextBlock.valid())
+            nextBlock.wait();
         if (pindex && fAbortRescan) {
             LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
         }
@@ -2168,6 +2410,130 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
     return ret;
 }
 
+/**
+ * Restore the transactions of an HD wallet, e.g. after it was recreated from
+ * its mnemonic. Keys found in use move the keypool forward, so both chains are
+ * always searched up to the keypool size (-keypool) past their last used key.
+ *
+ * With -addressindex only the blocks which pay to or spend from one of the
+ * wallet's keys, redeem scripts or watch-only scripts are read, querying the
+ * index again for the keys added to the keypool until no new ones show up.
+ * Otherwise, or if the wallet watches a script the address index doesn't
+ * cover (e.g. bare multisig), this falls back to ScanForWalletTransactions
+ * starting at pindexStart.
+ *
+ * The address index doesn't cover grouped (token) outputs either, so the
+ * blocks from ATPStartHeight on, where token groups can appear, are always
+ * scanned with ScanForWalletTransactions.
+ *
+ * Returns null if the restore was successful, see ScanForWalletTransactions.
+ */
+CBlockIndex* CWallet::RestoreHDWallet(CBlockIndex* pindexStart)
+{
+    const CChainParams& chainParams = Params();
+    const int nTokenHeight = chainParams.GetConsensus().ATPStartHeight;
+    if (!fAddressIndex || !IsHDEnabled() || pindexStart->nHeight >= nTokenHeight)
+        return ScanForWalletTransactions(pindexStart, true);
+
+    CBlockIndex* ret = nullptr;
+    {
+        LOCK2(cs_main, cs_wallet);
+        if (!TopUpKeyPool()) {
+            LogPrintf("%s: Topping up keypool failed (locked wallet)\n", __func__);
+        }
+
+        fAbortRescan = false;
+        fScanningWallet = true;
+        ShowProgress(_("Rescanning..."), 0);
+
+        // Address index entries (type 1 for keys, 2 for scripts) which were queried already
+        std::set<std::pair<int, uint160> > setQueried;
+        int nBlocksRead = 0;
+        while (!fAbortRescan) {
+            std::set<std::pair<int, uint160> > setAddresses;
+            std::set<CKeyID> setKeys;
+            GetKeys(setKeys);
+            for (const CKeyID& keyid : setKeys) {
+                setAddresses.emplace(1, keyid);
+            }
+            for (const auto& hdPubKey : mapHdPubKeys) {
+                setAddresses.emplace(1, hdPubKey.first);
+            }
+            bool fUnindexedScript = false;
+            {
+                LOCK(cs_KeyStore);
+                for (const auto& script : mapScripts) {
+                    setAddresses.emplace(2, script.first);
+                }
+                for (const CScript& script : setWatchOnly) {
+                    CTxDestination dest;
+                    if (!ExtractDestination(script, dest)) {
+                        fUnindexedScript = true;
+                    } else if (const CKeyID* keyid = boost::get<CKeyID>(&dest)) {
+                        setAddresses.emplace(1, *keyid);
+                    } else if (const CScriptID* scriptid = boost::get<CScriptID>(&dest)) {
+                        setAddresses.emplace(2, *scriptid);
+                    }
+                }
+            }
+            if (fUnindexedScript) {
+                LogPrintf("%s: Wallet watches scripts which are not in the address index, rescanning all blocks\n", __func__);
+                fScanningWallet = false;
+                ShowProgress(_("Rescanning..."), 100);
+                return ScanForWalletTransactions(pindexStart, true);
+            }
+
+            // Heights of the blocks involving keys and scripts which weren't queried yet
+            std::set<int> setHeights;
+            for (const auto& address : setAddresses) {
+                if (!setQueried.insert(address).second)
+                    continue;
+                std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+                if (!GetAddressIndex(address.second, address.first, vAddressIndex)) {
+                    fScanningWallet = false;
+                    ShowProgress(_("Rescanning..."), 100);
+                    return ScanForWalletTransactions(pindexStart, true);
+                }
+                for (const auto& entry : vAddressIndex) {
+                    if (entry.first.blockHeight >= pindexStart->nHeight && entry.first.blockHeight < nTokenHeight)
+                        setHeights.insert(entry.first.blockHeight);
+                }
+            }
+            if (setHeights.empty())
+                break;
+
+            for (int nHeight : setHeights) {
+                CBlockIndex* pindex = chainActive[nHeight];
+                if (!pindex || fAbortRescan)
+                    continue;
+                CBlock block;
+                if (ReadBlockFromDisk(block, pindex, chainParams.GetConsensus())) {
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, true);
+                    }
+                } else if (!ret || pindex->nHeight > ret->nHeight) {
+                    ret = pindex;
+                }
+                nBlocksRead++;
+            }
+        }
+        if (fAbortRescan) {
+            LogPrintf("%s: Restore aborted\n", __func__);
+        }
+        LogPrintf("%s: Read %d blocks for %d keys and scripts\n", __func__, nBlocksRead, setQueried.size());
+
+        ShowProgress(_("Rescanning..."), 100);
+        fScanningWallet = false;
+
+        if (!fAbortRescan && chainActive.Height() >= nTokenHeight) {
+            CBlockIndex* pindexFailed = ScanForWalletTransactions(chainActive[nTokenHeight], true);
+            if (pindexFailed)
+                ret = pindexFailed;
+        }
+    }
+    return ret;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     // If transactions aren't being broadcasted, don't let them into local mempool either
@@ -2935,6 +3301,27 @@ CAmount CWallet::GetAvailableBalance(const CCoinControl* coinControl) const
     return balance;
 }
 
+/** Depth of a wallet transaction whose outputs may be returned by FilterCoins, negative otherwise */
+static int GetFilterableDepth(const CWalletTx* pcoin)
+{
+    if (!CheckFinalTx(*pcoin))
+        return -1;
+
+    if (pcoin->IsGenerated() && pcoin->GetBlocksToMaturity() > 0)
+        return -1;
+
+    int nDepth = pcoin->GetDepthInMainChain();
+    if (nDepth < 0)
+        return -1;
+
+    // We should not consider coins which aren't at least in our mempool
+    // It's possible for these to be conflicted via ancestors which we may never be able to detect
+    if (nDepth == 0 && !pcoin->InMempool())
+        return -1;
+
+    return nDepth;
+}
+
 unsigned int CWallet::FilterCoins(std::vector<COutput> &vCoins,
     std::function<bool(const CWalletTx *, const CTxOut *)> func) const
 {
@@ -2948,21 +3335,10 @@ unsigned int CWallet::FilterCoins(std::vector<COutput> &vCoins,
             const uint256 &wtxid = it->first;
             const CWalletTx *pcoin = &(*it).second;
 
-            if (!CheckFinalTx(*pcoin))
-                continue;
-
-            if (pcoin->IsGenerated() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            int nDepth = pcoin->GetDepthInMainChain();
+            int nDepth = GetFilterableDepth(pcoin);
             if (nDepth < 0)
                 continue;
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
-
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
             {
                 isminetype mine = IsMine(pcoin->tx->vout[i]);
@@ -2980,6 +3356,63 @@ unsigned int CWallet::FilterCoins(std::vector<COutput> &vCoins,
     return ret;
 }
 
+unsigned int CWallet::FilterGroupCoins(std::vector<COutput> &vCoins, const CTokenGroupID &grpID,
+    std::function<bool(const CWalletTx *, const CTxOut *)> func) const
+{
+    vCoins.clear();
+    unsigned int ret = 0;
+
+    {
+        LOCK2(cs_main, cs_wallet);
+        auto itGroup = mapGroupedOutputs.find(grpID);
+        if (itGroup == mapGroupedOutputs.end())
+            return 0;
+
+        const CWalletTx *pcoin = nullptr;
+        int nDepth = -1;
+        for (const COutPoint& outpoint : itGroup->second)
+        {
+            // outpoints are sorted, so all outputs of a transaction are neighbours
+            if (!pcoin || pcoin->GetHash() != outpoint.hash) {
+                pcoin = GetWalletTx(outpoint.hash);
+                if (!pcoin)
+                    continue;
+                nDepth = GetFilterableDepth(pcoin);
+            }
+            if (nDepth < 0)
+                continue;
+
+            const CTxOut *out = &pcoin->tx->vout[outpoint.n];
+            isminetype mine = IsMine(*out);
+            if (!(IsSpent(outpoint.hash, outpoint.n)) && mine != ISMINE_NO && !IsLockedCoin(outpoint.hash, outpoint.n) &&
+                func(pcoin, out))
+            {
+                COutput coin(pcoin, outpoint.n, nDepth, (mine & ISMINE_SPENDABLE) != ISMINE_NO, false, false);
+                vCoins.push_back(coin);
+                ret++;
+            }
+        }
+    }
+    return ret;
+}
+
+unsigned int CWallet::FilterGroupCoins(std::vector<COutput> &vCoins,
+    std::function<bool(const CWalletTx *, const CTxOut *)> func) const
+{
+    vCoins.clear();
+    unsigned int ret = 0;
+
+    {
+        LOCK2(cs_main, cs_wallet);
+        std::vector<COutput> vGroupCoins;
+        for (const auto& group : mapGroupedOutputs) {
+            ret += FilterGroupCoins(vGroupCoins, group.first, func);
+            vCoins.insert(vCoins.end(), vGroupCoins.begin(), vGroupCoins.end());
+        }
+    }
+    return ret;
+}
+
 void CWallet::AvailableCoins(std::vector<COutput> &vCoins, bool fOnlySafe, const CCoinControl *coinControl, const CAmount &nMinimumAmount, const CAmount &nMaximumAmount, const CAmount &nMinimumSumAmount, const uint64_t &nMaximumCount, const int &nMinDepth, const int &nMaxDepth, const bool includeGrouped) const
 {
     vCoins.clear();
@@ -3198,6 +3631,80 @@ static void ApproximateBestSubset(const std::vector<CInputCoin>& vValue, const C
     }
 }
 
+// Depth first branch and bound search over vValue, which must be sorted by
+// descending value, for the subset with the smallest sum >= nTargetValue
+// (fewest inputs on ties). The search stops at an exact match, after
+// COIN_SELECTION_BNB_MAX_TRIES steps or at nTimeLimit (in microseconds) and
+// keeps the best subset found so far. Returns false if none was found.
+static bool SelectCoinsBnB(const std::vector<CInputCoin>& vValue, const CAmount& nTargetValue,
+                           std::vector<char>& vfBest, CAmount& nBest, int64_t nTimeLimit)
+{
+    const size_t nCoins = vValue.size();
+    // vRemaining[i] is the sum of vValue[i..], used to prune branches which can't reach the target
+    std::vector<CAmount> vRemaining(nCoins + 1, 0);
+    for (size_t i = nCoins; i > 0; i--) {
+        vRemaining[i - 1] = vRemaining[i] + vValue[i - 1].txout.nValue;
+    }
+    if (vRemaining[0] < nTargetValue)
+        return false;
+
+    std::vector<size_t> vSelected;
+    std::vector<size_t> vBestSelected;
+    bool fFound = false;
+    CAmount nCurrent = 0;
+    size_t i = 0;
+
+    for (int nTries = 0; nTries < COIN_SELECTION_BNB_MAX_TRIES; nTries++) {
+        if ((nTries & 1023) == 1023 && GetTimeMicros() > nTimeLimit)
+            break;
+
+        bool fBacktrack = false;
+        if (nCurrent >= nTargetValue) {
+            if (!fFound || nCurrent < nBest || (nCurrent == nBest && vSelected.size() < vBestSelected.size())) {
+                fFound = true;
+                nBest = nCurrent;
+                vBestSelected = vSelected;
+                if (nBest == nTargetValue)
+                    break;
+            }
+            fBacktrack = true;
+        } else if (nCurrent + vRemaining[i] < nTargetValue) {
+            fBacktrack = true;
+        } else if (fFound && nCurrent + vValue[nCoins - 1].txout.nValue >= nBest) {
+            // Even the smallest coin can't improve on the best subset anymore
+            fBacktrack = true;
+        }
+
+        if (fBacktrack) {
+            if (vSelected.empty())
+                break; // searched everything
+            // Exclude the last included coin and every following coin of the
+            // same value, those branches are equivalent to ones already visited.
+            const size_t nLast = vSelected.back();
+            vSelected.pop_back();
+            nCurrent -= vValue[nLast].txout.nValue;
+            i = nLast + 1;
+            while (i < nCoins && vValue[i].txout.nValue == vValue[nLast].txout.nValue) {
+                i++;
+            }
+            continue;
+        }
+
+        // Include the next coin
+        vSelected.push_back(i);
+        nCurrent += vValue[i].txout.nValue;
+        i++;
+    }
+
+    if (!fFound)
+        return false;
+    vfBest.assign(nCoins, false);
+    for (size_t nIndex : vBestSelected) {
+        vfBest[nIndex] = true;
+    }
+    return true;
+}
+
 struct CompareByPriority
 {
     bool operator()(const COutput& t1,
@@ -3207,22 +3714,6 @@ struct CompareByPriority
     }
 };
 
-// move denoms down
-bool less_then_denom (const COutput& out1, const COutput& out2)
-{
-    const CWalletTx *pcoin1 = out1.tx;
-    const CWalletTx *pcoin2 = out2.tx;
-
-    bool found1 = false;
-    bool found2 = false;
-    for (const auto& d : CPrivateSend::GetStandardDenominations()) // loop through predefined denoms
-    {
-        if(pcoin1->tx->vout[out1.i].nValue == d) found1 = true;
-        if(pcoin2->tx->vout[out2.i].nValue == d) found2 = true;
-    }
-    return (!found1 && found2);
-}
-
 bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, std::vector<COutput> vCoins,
                                  std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, CoinType nCoinType) const
 {
@@ -3249,7 +3740,9 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
     } else {
         // move denoms down on the list
         // try not to use denominated coins when not needed, save denoms for privatesend
-        std::sort(vCoins.begin(), vCoins.end(), less_then_denom);
+        std::stable_partition(vCoins.begin(), vCoins.end(), [](const COutput& out) {
+            return !CPrivateSend::IsDenominatedAmount(out.tx->tx->vout[out.i].nValue);
+        });
     }
 
     // try to find nondenom first to prevent unneeded spending of mixed coins
@@ -3271,7 +3764,8 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
             if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs) && !fLockedByIS)
                 continue;
 
-            if (!mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors))
+            // confirmed transactions can't be in the mempool
+            if (output.nDepth <= 0 && !mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors))
                 continue;
 
             int i = output.i;
@@ -3342,9 +3836,30 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
     std::vector<char> vfBest;
     CAmount nBest;
 
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
-    if (nBest != nTargetValue && nMinChange != 0 && nTotalLower >= nTargetValue + nMinChange)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + nMinChange, vfBest, nBest);
+    // The stochastic approximation runs 1000 passes over all candidates, which
+    // gets slow for wallets with many small outputs (e.g. staking rewards).
+    // Search those with time capped branch and bound instead and only fall
+    // back if it doesn't come up with any solution.
+    bool fSolved = false;
+    if (vValue.size() >= COIN_SELECTION_BNB_MIN_INPUTS) {
+        int64_t nTimeLimit = GetTimeMicros() + COIN_SELECTION_BNB_MAX_TIME;
+        fSolved = SelectCoinsBnB(vValue, nTargetValue, vfBest, nBest, nTimeLimit);
+        if (fSolved && nBest != nTargetValue && nMinChange != 0 && nTotalLower >= nTargetValue + nMinChange) {
+            // Keep the first subset if none leaving MIN_CHANGE is found in the remaining time
+            std::vector<char> vfBestChange;
+            CAmount nBestChange;
+            if (SelectCoinsBnB(vValue, nTargetValue + nMinChange, vfBestChange, nBestChange, nTimeLimit)) {
+                vfBest.swap(vfBestChange);
+                nBest = nBestChange;
+            }
+        }
+        LogPrint(BCLog::SELECTCOINS, "SelectCoinsMinConf: branch and bound over %u inputs %s\n", vValue.size(), fSolved ? "succeeded" : "failed");
+    }
+    if (!fSolved) {
+        ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
+        if (nBest != nTargetValue && nMinChange != 0 && nTotalLower >= nTargetValue + nMinChange)
+            ApproximateBestSubset(vValue, nTotalLower, nTargetValue + nMinChange, vfBest, nBest);
+    }
 
     // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
     //                                   or the next bigger coin is closer), return the bigger coin
@@ -3469,7 +3984,8 @@ bool CWallet::SignTransaction(CMutableTransaction &tx)
     AssertLockHeld(cs_wallet); // mapWallet
 
     CTransaction txNewConst(tx);
-    int nIn = 0;
+    std::vector<CTxOut> vSpentOutputs;
+    vSpentOutputs.reserve(tx.vin.size());
     for (const auto &input : tx.vin)
     {
         std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(input.prevout.hash);
@@ -3477,15 +3993,15 @@ bool CWallet::SignTransaction(CMutableTransaction &tx)
         {
             return false;
         }
-        const CScript &scriptPubKey = mi->second.tx->vout[input.prevout.n].scriptPubKey;
-        SignatureData sigdata;
+        vSpentOutputs.push_back(mi->second.tx->vout[input.prevout.n]);
+    }
 
-        if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, SIGHASH_ALL), scriptPubKey, sigdata)) {
-            return error("%s: Signing transaction failed\n", __func__);
-        } else {
-            UpdateTransaction(tx, nIn, sigdata);
-        }
-        nIn++;
+    std::vector<SignatureData> vSigData;
+    if (!ProduceSignatures(*this, txNewConst, vSpentOutputs, SIGHASH_ALL, vSigData)) {
+        return error("%s: Signing transaction failed\n", __func__);
+    }
+    for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+        UpdateTransaction(tx, nIn, vSigData[nIn]);
     }
     return true;
 }
@@ -4303,21 +4819,23 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
         if (sign)
         {
             CTransaction txNewConst(txNew);
-            int nIn = 0;
-            for(const auto& txdsin : vecTxDSInTmp)
+            std::vector<CTxOut> vSpentOutputs;
+            vSpentOutputs.reserve(vecTxDSInTmp.size());
+            for (const auto& txdsin : vecTxDSInTmp)
             {
-                const CScript& scriptPubKey = txdsin.prevPubKey;
-                SignatureData sigdata;
-
-                if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, SIGHASH_ALL), scriptPubKey, sigdata))
-                {
-                    strFailReason = _("Signing transaction failed");
-                    return false;
-                } else {
-                    UpdateTransaction(txNew, nIn, sigdata);
-                }
+                auto mi = mapWallet.find(txdsin.prevout.hash);
+                CAmount nAmount = mi != mapWallet.end() && txdsin.prevout.n < mi->second.tx->vout.size() ? mi->second.tx->vout[txdsin.prevout.n].nValue : 0;
+                vSpentOutputs.emplace_back(nAmount, txdsin.prevPubKey);
+            }
 
-                nIn++;
+            std::vector<SignatureData> vSigData;
+            if (!ProduceSignatures(*this, txNewConst, vSpentOutputs, SIGHASH_ALL, vSigData))
+            {
+                strFailReason = _("Signing transaction failed");
+                return false;
+            }
+            for (unsigned int nIn = 0; nIn < txNew.vin.size(); nIn++) {
+                UpdateTransaction(txNew, nIn, vSigData[nIn]);
             }
         }
 
@@ -4754,6 +5272,13 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         }
         bool fInternal = false;
         CWalletDB walletdb(*dbw);
+        std::vector<CPubKey> vExternalKeys, vInternalKeys;
+        if (IsHDEnabled()) {
+            // Derive the missing keys of each chain in one go instead of one by one
+            CKeyMetadata metadata(GetTime());
+            DeriveNewChildKeys(walletdb, metadata, 0, false, missingExternal, vExternalKeys);
+            DeriveNewChildKeys(walletdb, metadata, 0, true, missingInternal, vInternalKeys);
+        }
         for (int64_t i = missingInternal + missingExternal; i--;)
         {
             if (i < missingInternal) {
@@ -4764,7 +5289,14 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             int64_t index = ++m_max_keypool_index;
 
             // TODO: implement keypools for all accounts?
-            CPubKey pubkey(GenerateNewKey(walletdb, 0, fInternal));
+            CPubKey pubkey;
+            if (!IsHDEnabled()) {
+                pubkey = GenerateNewKey(walletdb, 0, fInternal);
+            } else if (fInternal) {
+                pubkey = vInternalKeys[missingInternal - 1 - i];
+            } else {
+                pubkey = vExternalKeys[missingInternal + missingExternal - 1 - i];
+            }
             if (!walletdb.WritePool(index, CKeyPool(pubkey, fInternal))) {
                 throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
             }
@@ -5411,6 +5943,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
                                                             CURRENCY_UNIT, FormatMoney(DEFAULT_TRANSACTION_MINFEE)));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
                                                             CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
+    strUsage += HelpMessageOpt("-hdrestore", _("Restore the transactions of an HD wallet on startup. Both HD chains are searched up to the -keypool gap limit, only reading the blocks which involve the wallet's keys when -addressindex is enabled (implies -rescan)"));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions on startup"));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet on startup"));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), DEFAULT_SPEND_ZEROCONF_CHANGE));
@@ -5613,14 +6146,21 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
         uiInterface.InitMessage(_("Rescanning..."));
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
 
+        // A restored HD wallet is younger than its keys, so the birthday is meaningless
+        bool fRestoreHD = gArgs.GetBoolArg("-hdrestore", false) && walletInstance->IsHDEnabled();
+
         // No need to read and scan block if block was created before
         // our wallet birthday (as adjusted for block time variability)
-        while (pindexRescan && walletInstance->nTimeFirstKey && (pindexRescan->GetBlockTime() < (walletInstance->nTimeFirstKey - TIMESTAMP_WINDOW))) {
+        while (!fRestoreHD && pindexRescan && walletInstance->nTimeFirstKey && (pindexRescan->GetBlockTime() < (walletInstance->nTimeFirstKey - TIMESTAMP_WINDOW))) {
             pindexRescan = chainActive.Next(pindexRescan);
         }
 
         nStart = GetTimeMillis();
-        walletInstance->ScanForWalletTransactions(pindexRescan, true);
+        if (fRestoreHD) {
+            walletInstance->RestoreHDWallet(pindexRescan);
+        } else {
+            walletInstance->ScanForWalletTransactions(pindexRescan, true);
+        }
         LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
         walletInstance->SetBestChain(chainActive.GetLocator());
         walletInstance->dbw->IncrementUpdateCounter();
@@ -5717,6 +6257,11 @@ bool CWallet::ParameterInteraction()
         }
     }
 
+    // -hdrestore implies a rescan
+    if (gArgs.GetBoolArg("-hdrestore", false) && gArgs.SoftSetBoolArg("-rescan", true)) {
+        LogPrintf("%s: parameter interaction: -hdrestore=1 -> setting -rescan=1\n", __func__);
+    }
+
     int zapwallettxes = gArgs.GetArg("-zapwallettxes", 0);
     // -zapwallettxes implies dropping the mempool on startup
     if (zapwallettxes != 0 && gArgs.SoftSetBoolArg("-persistmempool", false)) {
@@ -49,6 +49,8 @@ extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
+//! Minimum number of HD keys derived at once before the derivation is split across threads
+static const unsigned int PARALLEL_KEY_DERIVATION_MIN_KEYS = 64;
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
 //! -fallbackfee default
@@ -63,6 +65,12 @@ static const CAmount WALLET_INCREMENTAL_RELAY_FEE = 15000;
 static const CAmount MIN_CHANGE = CENT;
 //! final minimum change amount after paying for fees
 static const CAmount MIN_FINAL_CHANGE = MIN_CHANGE/2;
+//! Use branch and bound coin selection when there are at least this many candidate inputs
+static const size_t COIN_SELECTION_BNB_MIN_INPUTS = 1000;
+//! Maximum number of branch and bound steps per coin selection
+static const int COIN_SELECTION_BNB_MAX_TRIES = 100000;
+//! Maximum time spent in branch and bound per coin selection, in microseconds
+static const int64_t COIN_SELECTION_BNB_MAX_TIME = 250 * 1000;
 //! Default for -spendzeroconfchange
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 //! Default for -walletrejectlongchains
@@ -790,6 +798,15 @@ private:
 
     std::set<COutPoint> setWalletUTXO;
 
+    /**
+     * Outputs of wallet transactions which carry a token group, keyed by the
+     * associated group (subgroups have their own entry). Spent, conflicted and
+     * not yet mature outputs stay in here and are filtered when queried, so
+     * spends, abandons and reorgs need no bookkeeping.
+     */
+    std::map<CTokenGroupID, std::set<COutPoint>> mapGroupedOutputs;
+    void AddToGroupedOutputs(const CWalletTx& wtx);
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
@@ -801,6 +818,8 @@ private:
 
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(CWalletDB &walletdb, const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
+    /* HD derive nCount new child keys at once (on the HD chain), the keys are derived in parallel */
+    void DeriveNewChildKeys(CWalletDB &walletdb, const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, unsigned int nCount, std::vector<CPubKey>& vPubKeysRet);
 
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool;
@@ -949,6 +968,18 @@ public:
     unsigned int FilterCoins(std::vector<COutput> &vCoins,
         std::function<bool(const CWalletTx *, const CTxOut *)>) const;
 
+    /**
+     * Like FilterCoins, but only visits outputs of the given token group.
+     */
+    unsigned int FilterGroupCoins(std::vector<COutput> &vCoins, const CTokenGroupID &grpID,
+        std::function<bool(const CWalletTx *, const CTxOut *)>) const;
+
+    /**
+     * Like FilterCoins, but only visits outputs carrying any token group.
+     */
+    unsigned int FilterGroupCoins(std::vector<COutput> &vCoins,
+        std::function<bool(const CWalletTx *, const CTxOut *)>) const;
+
     /**
      * Return list of available coins and locked coins grouped by non-change output address.
      */
@@ -1080,10 +1111,16 @@ public:
     bool LoadToWallet(const CWalletTx& wtxIn);
     void TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
+    /**
+     * Marks the transactions of a block which BlockConnected has to sync into this wallet.
+     * Only needs cs_wallet, so it can run for several wallets at once.
+     */
+    std::vector<bool> FilterBlockTransactions(const CBlock& block) const;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
     bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     int64_t RescanFromTime(int64_t startTime, bool update);
     CBlockIndex* ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    CBlockIndex* RestoreHDWallet(CBlockIndex* pindexStart);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override;
     // ResendWalletTransactionsBefore may only be called if fBroadcastTransactions!
@@ -9,6 +9,9 @@
 #include "xion/accumulators.h"
 #include "xion/zerocoindb.h"
 
+#include <atomic>
+#include <thread>
+
 //Construct accumulators for all denominations
 AccumulatorMap::AccumulatorMap(libzerocoin::ZerocoinParams* params)
 {
@@ -71,6 +74,49 @@ bool AccumulatorMap::Accumulate(const libzerocoin::PublicCoin& pubCoin, bool fSk
     return true;
 }
 
+//Add a batch of zerocoins. Each denomination is accumulated on its own thread since the modexps of
+//different accumulators are independent of each other.
+bool AccumulatorMap::Accumulate(const std::list<libzerocoin::PublicCoin>& listPubcoins, bool fSkipValidation)
+{
+    std::map<libzerocoin::CoinDenomination, std::vector<const libzerocoin::PublicCoin*> > mapPubcoinsByDenom;
+    for (const libzerocoin::PublicCoin& pubCoin : listPubcoins) {
+        libzerocoin::CoinDenomination denom = pubCoin.getDenomination();
+        if (denom == libzerocoin::CoinDenomination::ZQ_ERROR)
+            return false;
+        mapPubcoinsByDenom[denom].emplace_back(&pubCoin);
+    }
+
+    std::atomic<bool> fSuccess{true};
+    auto accumulateDenom = [&fSuccess, fSkipValidation](libzerocoin::Accumulator* accumulator, const std::vector<const libzerocoin::PublicCoin*>& vPubcoins) {
+        try {
+            for (const libzerocoin::PublicCoin* pubCoin : vPubcoins) {
+                if (fSkipValidation)
+                    accumulator->increment(pubCoin->getValue());
+                else
+                    accumulator->accumulate(*pubCoin);
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("AccumulatorMap::Accumulate : failed to accumulate denomination %d: %s\n", (int)accumulator->getDenomination(), e.what());
+            fSuccess = false;
+        }
+    };
+
+    if (mapPubcoinsByDenom.size() <= 1) {
+        for (auto& it : mapPubcoinsByDenom)
+            accumulateDenom(mapAccumulators.at(it.first).get(), it.second);
+        return fSuccess;
+    }
+
+    std::vector<std::thread> vThreads;
+    vThreads.reserve(mapPubcoinsByDenom.size());
+    for (auto& it : mapPubcoinsByDenom)
+        vThreads.emplace_back(accumulateDenom, mapAccumulators.at(it.first).get(), std::cref(it.second));
+    for (std::thread& thread : vThreads)
+        thread.join();
+
+    return fSuccess;
+}
+
 libzerocoin::Accumulator AccumulatorMap::GetAccumulator(libzerocoin::CoinDenomination denom)
 {
     return libzerocoin::Accumulator(params, denom, GetValue(denom));
@@ -84,6 +130,15 @@ CBigNum AccumulatorMap::GetValue(libzerocoin::CoinDenomination denom)
     return mapAccumulators.at(denom)->getValue();
 }
 
+//Get the values of all accumulators
+AccumulatorCheckpoints::Checkpoint AccumulatorMap::GetValues()
+{
+    AccumulatorCheckpoints::Checkpoint values;
+    for (auto& denom : libzerocoin::zerocoinDenomList)
+        values.emplace(denom, mapAccumulators.at(denom)->getValue());
+    return values;
+}
+
 //Calculate a 32bit checksum of each accumulator value. Concatenate checksums into uint256
 uint256 AccumulatorMap::GetCheckpoint()
 {
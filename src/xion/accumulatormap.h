@@ -9,6 +9,8 @@
 #include "libzerocoin/Coin.h"
 #include "xion/accumulatorcheckpoints.h"
 
+#include <list>
+
 //A map with an accumulator for each denomination
 class AccumulatorMap
 {
@@ -20,8 +22,10 @@ public:
     bool Load(uint256 nCheckpoint);
     void Load(const AccumulatorCheckpoints::Checkpoint& checkpoint);
     bool Accumulate(const libzerocoin::PublicCoin& pubCoin, bool fSkipValidation = false);
+    bool Accumulate(const std::list<libzerocoin::PublicCoin>& listPubcoins, bool fSkipValidation = false);
     libzerocoin::Accumulator GetAccumulator(libzerocoin::CoinDenomination denom);
     CBigNum GetValue(libzerocoin::CoinDenomination denom);
+    AccumulatorCheckpoints::Checkpoint GetValues();
     uint256 GetCheckpoint();
     void Reset();
     void Reset(libzerocoin::ZerocoinParams* params2);
@@ -7,7 +7,9 @@
 #include "init.h"
 #include "pos/checks.h"
 #include "spork.h"
+#include "saltedhasher.h"
 #include "tinyformat.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 #include "xion/accumulators.h"
 #include "xion/accumulatormap.h"
@@ -19,6 +21,21 @@
 std::map<uint32_t, CBigNum> mapAccumulatorValues;
 std::list<uint256> listAccCheckpointsNoDB;
 
+//Pubcoins of recently connected blocks, keyed by block hash. Checkpoint calculation accumulates the mints of blocks
+//that were connected 10-20 blocks earlier, so keeping a few dozen blocks avoids re-reading and re-parsing them
+static CCriticalSection cs_pubcoinCache;
+static unordered_lru_cache<uint256, std::list<libzerocoin::PublicCoin>, StaticSaltedHasher, 64> pubcoinCache;
+
+//Result of the last checkpoint calculations, keyed by the hash of the block preceding the checkpoint block.
+//Lets block validation reuse the checkpoint already computed for a block template (TestBlockValidity) and vice versa
+struct CachedAccumulatorCheckpoint
+{
+    uint256 nCheckpoint;
+    AccumulatorCheckpoints::Checkpoint values;
+};
+static CCriticalSection cs_checkpointCache;
+static unordered_lru_cache<uint256, CachedAccumulatorCheckpoint, StaticSaltedHasher, 16> checkpointCache;
+
 
 uint32_t ParseChecksum(uint256 nChecksum, libzerocoin::CoinDenomination denomination)
 {
@@ -243,6 +260,41 @@ bool InitializeAccumulators(const int nHeight, int& nHeightCheckpoint, Accumulat
 }
 
 
+void CacheBlockPubcoins(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (pindex->nHeight < Params().GetConsensus().nZerocoinStartHeight || pindex->nHeight >= Params().GetConsensus().IIP0006Height)
+        return;
+
+    std::list<libzerocoin::PublicCoin> listPubcoins;
+    if (!BlockToPubcoinList(block, listPubcoins, false))
+        return;
+
+    LOCK(cs_pubcoinCache);
+    pubcoinCache.insert(pindex->GetBlockHash(), listPubcoins);
+}
+
+
+static bool GetBlockPubcoins(const CBlockIndex* pindex, std::list<libzerocoin::PublicCoin>& listPubcoins)
+{
+    {
+        LOCK(cs_pubcoinCache);
+        if (pubcoinCache.get(pindex->GetBlockHash(), listPubcoins))
+            return true;
+    }
+
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+        return error("%s: failed to read block from disk", __func__);
+
+    if (!BlockToPubcoinList(block, listPubcoins, false))
+        return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
+
+    LOCK(cs_pubcoinCache);
+    pubcoinCache.insert(pindex->GetBlockHash(), listPubcoins);
+    return true;
+}
+
+
 //Get checkpoint value for a specific block height
 bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint, AccumulatorMap& mapAccumulators)
 {
@@ -263,11 +315,21 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint, Accumulat
     if (!InitializeAccumulators(nHeight, nHeightCheckpoint, mapAccumulators))
         return error("%s: failed to initialize accumulators", __func__);
 
-    //Whether this should filter out invalid/fraudulent outpoints
-    bool fFilterInvalid = false;// nHeight >= Params().Zerocoin_Block_RecalculateAccumulators();
+    //reuse the result if this checkpoint was already calculated on top of the same chain
+    const uint256 hashPrev = chainActive[nHeight - 1]->GetBlockHash();
+    {
+        LOCK(cs_checkpointCache);
+        CachedAccumulatorCheckpoint cached;
+        if (checkpointCache.get(hashPrev, cached)) {
+            mapAccumulators.Load(cached.values);
+            nCheckpoint = cached.nCheckpoint;
+            LogPrint(BCLog::ZEROCOIN, "%s cached checkpoint=%s\n", __func__, nCheckpoint.GetHex());
+            return true;
+        }
+    }
 
-    //Accumulate all coins over the last ten blocks that havent been accumulated (height - 20 through height - 11)
-    int nTotalMintsFound = 0;
+    //Collect all coins over the last ten blocks that havent been accumulated (height - 20 through height - 11)
+    std::list<libzerocoin::PublicCoin> listPubcoinsTotal;
     CBlockIndex *pindex = chainActive[nHeightCheckpoint >= 20 ? nHeightCheckpoint - 20 : 0];
 
     while (pindex->nHeight < nHeight - 10) {
@@ -282,31 +344,30 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint, Accumulat
         }
 
         //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-            return error("%s: failed to read block from disk", __func__);
-
         std::list<libzerocoin::PublicCoin> listPubcoins;
-        if (!BlockToPubcoinList(block, listPubcoins, fFilterInvalid))
-            return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
+        if (!GetBlockPubcoins(pindex, listPubcoins))
+            return error("%s: failed to get pubcoins of block %d", __func__, pindex->nHeight);
 
-        nTotalMintsFound += listPubcoins.size();
         LogPrint(BCLog::ZEROCOIN, "%s found %d mints\n", __func__, listPubcoins.size());
-
-        //add the pubcoins to accumulator
-        for (const libzerocoin::PublicCoin& pubcoin : listPubcoins) {
-            if(!mapAccumulators.Accumulate(pubcoin, true))
-                return error("%s: failed to add pubcoin to accumulator at height %d", __func__, pindex->nHeight);
-        }
+        listPubcoinsTotal.splice(listPubcoinsTotal.end(), listPubcoins);
         pindex = chainActive.Next(pindex);
     }
 
+    //add the pubcoins to the accumulators, one thread per denomination
+    if (!mapAccumulators.Accumulate(listPubcoinsTotal, true))
+        return error("%s: failed to add pubcoins to accumulator at height %d", __func__, nHeight);
+
     // if there were no new mints found, the accumulator checkpoint will be the same as the last checkpoint
-    if (nTotalMintsFound == 0)
+    if (listPubcoinsTotal.empty())
         nCheckpoint = chainActive[nHeight - 1]->GetBlockHeader().nAccumulatorCheckpoint;
     else
         nCheckpoint = mapAccumulators.GetCheckpoint();
 
+    {
+        LOCK(cs_checkpointCache);
+        checkpointCache.insert(hashPrev, CachedAccumulatorCheckpoint{nCheckpoint, mapAccumulators.GetValues()});
+    }
+
     LogPrint(BCLog::ZEROCOIN, "%s checkpoint=%s\n", __func__, nCheckpoint.GetHex());
     return true;
 }
@@ -5,6 +5,8 @@
 #include "xion/xionchain.h"
 
 #include "consensus/validation.h"
+#include "ctpl.h"
+#include "init.h"
 #include "pos/checks.h"
 #include "xion/xionmodule.h"
 #include "xion/zerocoindb.h"
@@ -13,6 +15,9 @@
 #include "txdb.h"
 #include "ui_interface.h"
 
+#include <deque>
+#include <future>
+
 // 6 comes from OPCODE (1) + vch.size() (1) + BIGNUM size (4)
 #define SCRIPT_OFFSET 6
 // For Script size (BIGNUM/Uint256 size)
@@ -228,88 +233,148 @@ bool IsSerialInBlockchain(const uint256& hashSerial, int& nHeightTx, uint256& tx
     return IsTransactionInChain(txidSpend, nHeightTx, tx);
 }
 
+/** Zerocoin spends and mints found in one block */
+struct CZerocoinBlockInfo
+{
+    std::vector<std::pair<libzerocoin::CoinSpend, uint256> > vSpendInfo;
+    std::vector<std::pair<libzerocoin::PublicCoin, uint256> > vMintInfo;
+    std::string strError;
+};
+
+static CZerocoinBlockInfo ReadZerocoinBlockInfo(const CBlockIndex* pindex)
+{
+    CZerocoinBlockInfo info;
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        info.strError = _("Reindexing zerocoin failed");
+        return info;
+    }
+
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase() || !tx->ContainsZerocoins())
+            continue;
+
+        uint256 txid = tx->GetHash();
+        //Record Serials
+        if (tx->HasZerocoinSpendInputs()) {
+            for (auto& in : tx->vin) {
+                bool isPublicSpend = in.IsZerocoinPublicSpend();
+                if (!in.IsZerocoinSpend() && !isPublicSpend)
+                    continue;
+                if (isPublicSpend) {
+                    libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params(false);
+                    PublicCoinSpend publicSpend(params);
+                    CValidationState state;
+                    if (!XIONModule::ParseZerocoinPublicSpend(in, *tx, state, publicSpend)){
+                        info.strError = _("Failed to parse public spend");
+                        return info;
+                    }
+                    info.vSpendInfo.push_back(std::make_pair(publicSpend, txid));
+                } else {
+                    libzerocoin::CoinSpend spend = TxInToZerocoinSpend(in);
+                    info.vSpendInfo.push_back(std::make_pair(spend, txid));
+                }
+            }
+        }
+
+        //Record mints
+        if (tx->HasZerocoinMintOutputs()) {
+            for (auto& out : tx->vout) {
+                if (!out.IsZerocoinMint())
+                    continue;
+
+                CValidationState state;
+                libzerocoin::PublicCoin coin(Params().Zerocoin_Params(pindex->nHeight < Params().GetConsensus().nBlockZerocoinV2));
+                TxOutToPublicCoin(out, coin, state);
+                info.vMintInfo.push_back(std::make_pair(coin, txid));
+            }
+        }
+    }
+
+    return info;
+}
+
 std::string ReindexZerocoinDB()
 {
-    if (!zerocoinDB->WipeCoins("spends") || !zerocoinDB->WipeCoins("mints")) {
-        return _("Failed to wipe zerocoinDB");
+    const int nStartHeight = Params().GetConsensus().nBlockZerocoinV2;
+    CBlockIndex* pindex = chainActive[nStartHeight];
+
+    // Resume an interrupted reindex if the last flushed block is still part of the active chain
+    int nProgressHeight;
+    uint256 hashProgress;
+    if (zerocoinDB->ReadReindexProgress(nProgressHeight, hashProgress) && nProgressHeight >= nStartHeight &&
+        chainActive[nProgressHeight] && chainActive[nProgressHeight]->GetBlockHash() == hashProgress) {
+        LogPrintf("Reindexing zerocoin : resuming after block %d\n", nProgressHeight);
+        pindex = chainActive.Next(chainActive[nProgressHeight]);
+    } else {
+        if (!zerocoinDB->WipeCoins("spends") || !zerocoinDB->WipeCoins("mints")) {
+            return _("Failed to wipe zerocoinDB");
+        }
     }
 
     uiInterface.ShowProgress(_("Reindexing zerocoin database..."), 0);
 
-    CBlockIndex* pindex = chainActive[Params().GetConsensus().nBlockZerocoinV2];
+    // Blocks are read and parsed on the worker pool, results are consumed and written in chain order
+    const int nWorkers = std::max(1, GetNumCores());
+    const size_t nMaxQueueSize = nWorkers * 4;
+    ctpl::thread_pool workerPool(nWorkers);
+    RenameThreadPool(workerPool, "ion-zcreindex");
+
+    std::deque<std::pair<const CBlockIndex*, std::future<CZerocoinBlockInfo> > > queue;
+    CBlockIndex* pindexNext = pindex;
+    auto fillQueue = [&]() {
+        while (pindexNext && queue.size() < nMaxQueueSize) {
+            const CBlockIndex* pindexRead = pindexNext;
+            queue.emplace_back(pindexRead, workerPool.push([pindexRead](int threadId) {
+                return ReadZerocoinBlockInfo(pindexRead);
+            }));
+            pindexNext = chainActive.Next(pindexNext);
+        }
+    };
+
     std::vector<std::pair<libzerocoin::CoinSpend, uint256> > vSpendInfo;
     std::vector<std::pair<libzerocoin::PublicCoin, uint256> > vMintInfo;
-    while (pindex) {
-        uiInterface.ShowProgress(_("Reindexing zerocoin database..."), std::max(1, std::min(99, (int)((double)(pindex->nHeight - Params().GetConsensus().nBlockZerocoinV2) / (double)(chainActive.Height() - Params().GetConsensus().nBlockZerocoinV2) * 100))));
+    fillQueue();
+    while (!queue.empty()) {
+        pindex = const_cast<CBlockIndex*>(queue.front().first);
+        CZerocoinBlockInfo info = queue.front().second.get();
+        queue.pop_front();
+        fillQueue();
+
+        uiInterface.ShowProgress(_("Reindexing zerocoin database..."), std::max(1, std::min(99, (int)((double)(pindex->nHeight - nStartHeight) / (double)(chainActive.Height() - nStartHeight) * 100))));
 
         if (pindex->nHeight % 1000 == 0)
             LogPrintf("Reindexing zerocoin : block %d...\n", pindex->nHeight);
 
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-            return _("Reindexing zerocoin failed");
+        if (!info.strError.empty()) {
+            return info.strError;
         }
 
-        for (const CTransactionRef& tx : block.vtx) {
-            for (unsigned int i = 0; i < tx->vin.size(); i++) {
-                if (tx->IsCoinBase())
-                    break;
-
-                if (tx->ContainsZerocoins()) {
-                    uint256 txid = tx->GetHash();
-                    //Record Serials
-                    if (tx->HasZerocoinSpendInputs()) {
-                        for (auto& in : tx->vin) {
-                            bool isPublicSpend = in.IsZerocoinPublicSpend();
-                            if (!in.IsZerocoinSpend() && !isPublicSpend)
-                                continue;
-                            if (isPublicSpend) {
-                                libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params(false);
-                                PublicCoinSpend publicSpend(params);
-                                CValidationState state;
-                                if (!XIONModule::ParseZerocoinPublicSpend(in, *tx, state, publicSpend)){
-                                    return _("Failed to parse public spend");
-                                }
-                                vSpendInfo.push_back(std::make_pair(publicSpend, txid));
-                            } else {
-                                libzerocoin::CoinSpend spend = TxInToZerocoinSpend(in);
-                                vSpendInfo.push_back(std::make_pair(spend, txid));
-                            }
-                        }
-                    }
-
-                    //Record mints
-                    if (tx->HasZerocoinMintOutputs()) {
-                        for (auto& out : tx->vout) {
-                            if (!out.IsZerocoinMint())
-                                continue;
+        vSpendInfo.insert(vSpendInfo.end(), info.vSpendInfo.begin(), info.vSpendInfo.end());
+        vMintInfo.insert(vMintInfo.end(), info.vMintInfo.begin(), info.vMintInfo.end());
 
-                            CValidationState state;
-                            libzerocoin::PublicCoin coin(Params().Zerocoin_Params(pindex->nHeight < Params().GetConsensus().nBlockZerocoinV2));
-                            TxOutToPublicCoin(out, coin, state);
-                            vMintInfo.push_back(std::make_pair(coin, txid));
-                        }
-                    }
-                }
-            }
-        }
-
-        // Flush the zerocoinDB to disk every 100 blocks
+        // Flush the zerocoinDB to disk every 100 blocks and remember how far we got
         if (pindex->nHeight % 100 == 0) {
             if ((!vSpendInfo.empty() && !zerocoinDB->WriteCoinSpendBatch(vSpendInfo)) || (!vMintInfo.empty() && !zerocoinDB->WriteCoinMintBatch(vMintInfo)))
                 return _("Error writing zerocoinDB to disk");
             vSpendInfo.clear();
             vMintInfo.clear();
-        }
 
-        pindex = chainActive.Next(pindex);
+            if (!zerocoinDB->WriteReindexProgress(pindex->nHeight, pindex->GetBlockHash()))
+                return _("Error writing zerocoinDB to disk");
+
+            if (ShutdownRequested())
+                return _("Reindexing zerocoin interrupted");
+        }
     }
-    uiInterface.ShowProgress("", 100);
 
     // Final flush to disk in case any remaining information exists
     if ((!vSpendInfo.empty() && !zerocoinDB->WriteCoinSpendBatch(vSpendInfo)) || (!vMintInfo.empty() && !zerocoinDB->WriteCoinMintBatch(vMintInfo)))
         return _("Error writing zerocoinDB to disk");
 
+    zerocoinDB->EraseReindexProgress();
+
     uiInterface.ShowProgress("", 100);
 
     return "";
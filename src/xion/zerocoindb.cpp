@@ -144,3 +144,24 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint32_t& nChecksum)
     LogPrint(BCLog::ZEROCOIN, "%s : checksum:%d\n", __func__, nChecksum);
     return Erase(std::make_pair('2', nChecksum));
 }
+
+bool CZerocoinDB::WriteReindexProgress(int nHeight, const uint256& hashBlock)
+{
+    LogPrint(BCLog::ZEROCOIN, "%s : height:%d hash:%s\n", __func__, nHeight, hashBlock.GetHex());
+    return Write('r', std::make_pair(nHeight, hashBlock), true);
+}
+
+bool CZerocoinDB::ReadReindexProgress(int& nHeight, uint256& hashBlock)
+{
+    std::pair<int, uint256> progress;
+    if (!Read('r', progress))
+        return false;
+    nHeight = progress.first;
+    hashBlock = progress.second;
+    return true;
+}
+
+bool CZerocoinDB::EraseReindexProgress()
+{
+    return Erase('r', true);
+}
@@ -36,6 +36,10 @@ public:
     bool WriteAccumulatorValue(const uint32_t& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint32_t& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint32_t& nChecksum);
+    /** Last block flushed by an unfinished ReindexZerocoinDB */
+    bool WriteReindexProgress(int nHeight, const uint256& hashBlock);
+    bool ReadReindexProgress(int& nHeight, uint256& hashBlock);
+    bool EraseReindexProgress();
 };
 
 #endif //ION_ZEROCOINDB_H
@@ -68,6 +68,15 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
 
+        self.log.info("Test that the rolling statistics match a walk of the UTXO set")
+        res_muhash = node.gettxoutsetinfo("muhash")
+        for key in ['total_amount', 'height', 'txouts', 'bogosize', 'bestblock']:
+            assert_equal(res_muhash[key], res[key])
+        assert_equal(len(res_muhash['muhash']), 64)
+        assert 'hash_serialized_2' not in res_muhash
+        assert 'muhash' not in node.gettxoutsetinfo("none")
+        assert_raises_rpc_error(-8, "Unknown hash_type", node.gettxoutsetinfo, "sha1")
+
         self.log.info("Test that gettxoutsetinfo() works for blockchain with just the genesis block")
         b1hash = node.getblockhash(1)
         node.invalidateblock(b1hash)
@@ -80,6 +89,10 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res2['bogosize'], 0),
         assert_equal(res2['bestblock'], node.getblockhash(0))
         assert_equal(len(res2['hash_serialized_2']), 64)
+        res2_muhash = node.gettxoutsetinfo("muhash")
+        assert_equal(res2_muhash['txouts'], 0)
+        assert_equal(res2_muhash['bestblock'], node.getblockhash(0))
+        assert res2_muhash['muhash'] != res_muhash['muhash']
 
         self.log.info("Test that gettxoutsetinfo() returns the same result after invalidate/reconsider block")
         node.reconsiderblock(b1hash)
@@ -92,6 +105,12 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res['bogosize'], res3['bogosize'])
         assert_equal(res['bestblock'], res3['bestblock'])
         assert_equal(res['hash_serialized_2'], res3['hash_serialized_2'])
+        assert_equal(node.gettxoutsetinfo("muhash"), res_muhash)
+
+        self.log.info("Test that the rolling statistics are persisted with the chainstate")
+        self.stop_node(0)
+        self.start_node(0)
+        assert_equal(self.nodes[0].gettxoutsetinfo("muhash")['muhash'], res_muhash['muhash'])
 
     def _test_getblockheader(self):
         node = self.nodes[0]
@@ -26,6 +26,7 @@ class DIP3Test(BitcoinTestFramework):
         self.extra_args = ["-budgetparams=10:10:10"]
         self.extra_args += ["-sporkkey=93QPD8M8SrVb4yL3E679sCGztzy1NRWYH3fs2wJQr2LMKnppFCJ"]
         self.extra_args += ["-dip3params=135:150"]
+        self.extra_args += ["-specialtxindex"]
 
 
     def setup_network(self):
@@ -111,6 +112,9 @@ class DIP3Test(BitcoinTestFramework):
             self.sync_all()
             self.assert_mnlists(mns)
 
+        self.log.info("test the special tx index")
+        self.assert_protx_index(self.nodes[0], mns)
+
         self.log.info("test that MNs disappear from the list when the ProTx collateral is spent")
         spend_mns_count = 3
         mns_tmp = [] + mns
@@ -128,6 +132,7 @@ class DIP3Test(BitcoinTestFramework):
             self.nodes[0].invalidateblock(self.nodes[0].getbestblockhash())
             mns_tmp.append(mns[spend_mns_count - 1 - i])
             self.assert_mnlist(self.nodes[0], mns_tmp)
+        self.assert_protx_index(self.nodes[0], mns)
 
         self.log.info("cause a reorg with a double spend and check that mnlists are still correct on all nodes")
         self.mine_double_spend(self.nodes[0], dummy_txins, self.nodes[0].getnewaddress(), use_mnmerkleroot_from_tip=True)
@@ -296,6 +301,15 @@ class DIP3Test(BitcoinTestFramework):
         self.nodes[0].protx('update_service', mn.protx_hash, '127.0.0.1:%d' % mn.p2p_port, mn.blsMnkey, "", mn.fundsAddr)
         self.nodes[0].generate(1)
 
+    def assert_protx_index(self, node, mns):
+        height = node.getblockcount()
+        registered = node.getspecialtxesbyheight(1, 0, height, 1000)
+        assert_equal(sorted(registered), sorted(mn.protx_hash for mn in mns))
+        # the index must agree with scanning the blocks
+        for tx in node.getspecialtxesbyheight(-1, height - 10, height, 1000, 0, 2):
+            assert(tx['txid'] in node.getspecialtxes(tx['blockhash'], tx['type'], 1000))
+        assert_equal(node.getspecialtxesbyheight(1, height - 10, height, 1, len(registered)), [])
+
     def assert_mnlists(self, mns):
         for node in self.nodes:
             self.assert_mnlist(node, mns)
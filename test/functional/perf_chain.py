@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Time block production, block connection and mempool floods on regtest.
+
+- node0 mines blocks full of wallet transactions while node1 is disconnected
+- node1 connects the whole range when it reconnects
+- node1 accepts a flood of pre-signed transactions into its mempool, builds
+  a block template from them and mines it
+"""
+
+from test_framework.perf import PerfTestFramework
+from test_framework.util import *
+
+BLOCKS = 200
+TXS_PER_BLOCK = 10
+FLOOD_TXS = 1000
+
+class PerfChainTest(PerfTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def split_coins(self, node, count):
+        """Create count confirmed outputs of node's wallet, returns them as (txid, vout, amount)"""
+        utxos = []
+        while len(utxos) < count:
+            batch = min(count - len(utxos), 200)
+            outputs = {node.getnewaddress(): 1 for i in range(batch)}
+            txid = node.sendmany("", outputs)
+            for out in node.getrawtransaction(txid, 1)['vout']:
+                if out['value'] == 1:
+                    utxos.append((txid, out['n'], out['value']))
+        node.generate(1)
+        return utxos[:count]
+
+    def run_perf(self):
+        node0, node1 = self.nodes
+        blocks = self.scaled(BLOCKS)
+        txs_per_block = TXS_PER_BLOCK
+        flood_txs = self.scaled(FLOOD_TXS)
+
+        disconnect_nodes(node0, 1)
+        disconnect_nodes(node1, 0)
+
+        address = node0.getnewaddress()
+        with self.measure("generate_blocks_with_txs", blocks):
+            for i in range(blocks):
+                for j in range(txs_per_block):
+                    node0.sendtoaddress(address, 1)
+                node0.generate(1)
+
+        with self.measure("connect_blocks", blocks):
+            connect_nodes_bi(self.nodes, 0, 1)
+            sync_blocks(self.nodes, timeout=600)
+
+        self.log.info("Prepare %d signed transactions" % flood_txs)
+        utxos = self.split_coins(node0, flood_txs)
+        self.sync_all()
+        disconnect_nodes(node0, 1)
+        disconnect_nodes(node1, 0)
+        raw_txs = []
+        for txid, vout, amount in utxos:
+            raw = node0.createrawtransaction([{"txid": txid, "vout": vout}], {node1.getnewaddress(): amount - Decimal("0.001")})
+            raw_txs.append(node0.signrawtransaction(raw)['hex'])
+
+        with self.measure("mempool_accept", flood_txs):
+            for raw in raw_txs:
+                node1.sendrawtransaction(raw)
+        assert_equal(node1.getmempoolinfo()['size'], flood_txs)
+
+        with self.measure("getblocktemplate_full_mempool"):
+            node1.getblocktemplate()
+
+        with self.measure("mine_full_mempool"):
+            node1.generate(1)
+        assert_equal(node1.getmempoolinfo()['size'], 0)
+
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.sync_all()
+
+if __name__ == '__main__':
+    PerfChainTest().main()
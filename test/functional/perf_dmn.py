@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Time deterministic masternode registration churn on regtest.
+
+- many ProRegTx registrations with collateral inside the ProTx
+- a ProUpRegTx update of every registered masternode
+- a second node connecting all ProTx blocks, which rebuilds the list
+"""
+
+from test_framework.perf import PerfTestFramework
+from test_framework.util import *
+
+MASTERNODES = 40
+PROTX_PER_BLOCK = 5
+
+class PerfDMNTest(PerfTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        extra_args = ["-budgetparams=10:10:10", "-dip3params=135:150"]
+        self.extra_args = [extra_args, extra_args]
+
+    def run_perf(self):
+        node0, node1 = self.nodes
+        masternodes = self.scaled(MASTERNODES)
+
+        disconnect_nodes(node0, 1)
+        disconnect_nodes(node1, 0)
+
+        self.log.info("Fund %d collaterals and activate DIP3" % masternodes)
+        while node0.getbalance() < (masternodes + 1) * 1001 or node0.getblockcount() < 151:
+            node0.generate(10)
+
+        registered = []
+        with self.measure("protx_register_fund", masternodes):
+            for i in range(masternodes):
+                bls = node0.bls('generate')
+                funds_address = node0.getnewaddress()
+                owner_address = node0.getnewaddress()
+                node0.sendtoaddress(funds_address, 1000.001)
+                protx_hash = node0.protx('register_fund', node0.getnewaddress(), '127.0.0.1:%d' % (10000 + i),
+                                         owner_address, bls['public'], owner_address, 0, node0.getnewaddress(), funds_address)
+                registered.append((protx_hash, funds_address))
+                if i % PROTX_PER_BLOCK == PROTX_PER_BLOCK - 1:
+                    node0.generate(1)
+            node0.generate(1)
+        assert_equal(len(node0.protx('list')), masternodes)
+
+        with self.measure("protx_update_registrar", masternodes):
+            for i, (protx_hash, funds_address) in enumerate(registered):
+                node0.sendtoaddress(funds_address, 0.001)
+                node0.protx('update_registrar', protx_hash, '', node0.getnewaddress(), '', funds_address)
+                if i % PROTX_PER_BLOCK == PROTX_PER_BLOCK - 1:
+                    node0.generate(1)
+            node0.generate(1)
+
+        blocks = node0.getblockcount()
+        with self.measure("connect_protx_blocks", blocks):
+            connect_nodes_bi(self.nodes, 0, 1)
+            sync_blocks(self.nodes, timeout=600)
+        assert_equal(len(node1.protx('list')), masternodes)
+
+if __name__ == '__main__':
+    PerfDMNTest().main()
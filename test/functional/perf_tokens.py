@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Time token (ATP) mint and transfer storms on regtest.
+
+- many mint transactions of one token group
+- many token transfers to fresh addresses, mined in few blocks
+- a second node connecting all token blocks
+"""
+
+from test_framework.perf import PerfTestFramework
+from test_framework.util import *
+
+ION_AUTH_ADDR = "gAQQQjA4DCT2EZDVK6Jae4mFfB217V43Nt"
+ION_AUTH_KEY = "cUnScAFQYLW8J8V9bWr57yj2AopudqTd266s6QuWGMMfMix3Hff4"
+
+MINTS = 200
+TRANSFERS = 500
+TXS_PER_BLOCK = 20
+
+class PerfTokensTest(PerfTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_tokens(self, node):
+        """Create the MAGIC management token and a regular token, returns the group id of the latter"""
+        node.generate(100)
+        node.importprivkey(ION_AUTH_KEY)
+        node.generate(200)
+        node.sendtoaddress(ION_AUTH_ADDR, 10)
+        node.generate(1)
+        magic = node.configuremanagementtoken("MAGIC", "MagicToken", "4", "https://github.com/ioncoincore/ATP-descriptions/blob/master/ION-testnet-MAGIC.json", "4f92d91db24bb0b8ca24a2ec86c4b012ccdc4b2e9d659c2079f5cc358413a765", "true")
+        node.generate(1)
+        node.minttoken(magic['groupID'], node.getnewaddress(), 500)
+        node.generate(1)
+        perf = node.configuretoken("PERF", "PerfToken", "4", "https://github.com/ioncoincore/ATP-descriptions/blob/master/ION-testnet-MAGIC.json", "4f92d91db24bb0b8ca24a2ec86c4b012ccdc4b2e9d659c2079f5cc358413a765", "true")
+        node.generate(1)
+        return perf['groupID']
+
+    def run_perf(self):
+        node0, node1 = self.nodes
+        mints = self.scaled(MINTS)
+        transfers = self.scaled(TRANSFERS)
+
+        disconnect_nodes(node0, 1)
+        disconnect_nodes(node1, 0)
+        group_id = self.setup_tokens(node0)
+        start_height = node0.getblockcount()
+
+        mint_address = node0.getnewaddress()
+        with self.measure("token_mint", mints):
+            for i in range(mints):
+                node0.minttoken(group_id, mint_address, 1000)
+                if i % TXS_PER_BLOCK == TXS_PER_BLOCK - 1:
+                    node0.generate(1)
+            node0.generate(1)
+        assert_equal(Decimal(str(node0.gettokenbalance(group_id)['balance'])), mints * 1000)
+
+        with self.measure("token_transfer", transfers):
+            for i in range(transfers):
+                node0.sendtoken(group_id, node1.getnewaddress(), 1)
+                if i % TXS_PER_BLOCK == TXS_PER_BLOCK - 1:
+                    node0.generate(1)
+            node0.generate(1)
+
+        blocks = node0.getblockcount()
+        with self.measure("connect_token_blocks", blocks):
+            connect_nodes_bi(self.nodes, 0, 1)
+            sync_blocks(self.nodes, timeout=600)
+        assert_equal(Decimal(str(node1.gettokenbalance(group_id)['balance'])), transfers)
+        self.log.info("Connected %d token blocks after height %d" % (blocks - start_height, start_height))
+
+if __name__ == '__main__':
+    PerfTokensTest().main()
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Time large wallet transactions and wallet rescans on regtest.
+
+- sendmany calls with hundreds of outputs
+- importprivkey of a key with a long history, which rescans the chain
+- a full -rescan at startup
+"""
+
+from test_framework.perf import PerfTestFramework
+from test_framework.util import *
+
+SENDMANY_CALLS = 10
+SENDMANY_OUTPUTS = 500
+HISTORY_BLOCKS = 200
+HISTORY_TXS_PER_BLOCK = 5
+
+class PerfWalletTest(PerfTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def run_perf(self):
+        node0, node1 = self.nodes
+        sendmany_calls = self.scaled(SENDMANY_CALLS)
+        history_blocks = self.scaled(HISTORY_BLOCKS)
+
+        addresses = [node1.getnewaddress() for i in range(SENDMANY_OUTPUTS)]
+        with self.measure("sendmany_%d_outputs" % SENDMANY_OUTPUTS, sendmany_calls):
+            for i in range(sendmany_calls):
+                node0.sendmany("", {address: Decimal("0.01") for address in addresses})
+                node0.generate(1)
+        self.sync_all()
+
+        self.log.info("Build a history of %d blocks for one key" % history_blocks)
+        history_address = node0.getnewaddress()
+        for i in range(history_blocks):
+            for j in range(HISTORY_TXS_PER_BLOCK):
+                node0.sendtoaddress(history_address, 1)
+            node0.generate(1)
+        self.sync_all()
+        height = node1.getblockcount()
+
+        with self.measure("importprivkey_rescan", height):
+            node1.importprivkey(node0.dumpprivkey(history_address), "", True)
+        assert_equal(node1.getreceivedbyaddress(history_address, 0), history_blocks * HISTORY_TXS_PER_BLOCK)
+
+        self.stop_node(1)
+        with self.measure("startup_rescan", height):
+            self.start_node(1, extra_args=["-rescan"])
+        connect_nodes_bi(self.nodes, 0, 1)
+        assert_equal(node1.getreceivedbyaddress(history_address, 0), history_blocks * HISTORY_TXS_PER_BLOCK)
+
+if __name__ == '__main__':
+    PerfWalletTest().main()
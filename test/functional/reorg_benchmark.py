@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018-2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Benchmark reorgs on regtest.
+
+Times deep disconnects through invalidateblock/reconsiderblock and a
+competing-fork reorg between two nodes, while checking that the chain
+state, wallet balance and mempool end up consistent.
+"""
+
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+REORG_DEPTH = 60
+TXS_PER_BLOCK = 5
+
+class ReorgBenchmarkTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.extra_args = [["-spentindex", "-addressindex"], ["-spentindex", "-addressindex"]]
+
+    def mine_blocks_with_txs(self, node, count):
+        address = node.getnewaddress()
+        for i in range(count):
+            for j in range(TXS_PER_BLOCK):
+                node.sendtoaddress(address, 1)
+            node.generate(1)
+
+    def run_test(self):
+        node0 = self.nodes[0]
+        node1 = self.nodes[1]
+
+        self.log.info("Mine %d blocks with %d transactions each" % (REORG_DEPTH, TXS_PER_BLOCK))
+        self.mine_blocks_with_txs(node0, REORG_DEPTH)
+        self.sync_all()
+        tip_height = node0.getblockcount()
+        tip_hash = node0.getbestblockhash()
+        utxo_info = node0.gettxoutsetinfo()
+
+        self.log.info("Disconnect %d blocks with invalidateblock" % REORG_DEPTH)
+        fork_hash = node0.getblockhash(tip_height - REORG_DEPTH + 1)
+        start = time.time()
+        node0.invalidateblock(fork_hash)
+        elapsed_disconnect = time.time() - start
+        assert_equal(node0.getblockcount(), tip_height - REORG_DEPTH)
+
+        start = time.time()
+        node0.reconsiderblock(fork_hash)
+        elapsed_reconnect = time.time() - start
+        assert_equal(node0.getbestblockhash(), tip_hash)
+        assert_equal(node0.gettxoutsetinfo()['hash_serialized_2'], utxo_info['hash_serialized_2'])
+        self.log.info("invalidateblock: %.3fs (%.2fms/block), reconsiderblock: %.3fs (%.2fms/block)" %
+                      (elapsed_disconnect, elapsed_disconnect * 1000 / REORG_DEPTH,
+                       elapsed_reconnect, elapsed_reconnect * 1000 / REORG_DEPTH))
+
+        self.log.info("Build competing forks of %d and %d blocks" % (REORG_DEPTH, REORG_DEPTH + 1))
+        disconnect_nodes(node0, 1)
+        disconnect_nodes(node1, 0)
+        self.mine_blocks_with_txs(node0, REORG_DEPTH)
+        node1.generate(REORG_DEPTH + 1)
+        best_hash = node1.getbestblockhash()
+        balance = node0.getbalance()
+
+        self.log.info("Reorg node0 onto the longer fork")
+        start = time.time()
+        connect_nodes_bi(self.nodes, 0, 1)
+        wait_until(lambda: node0.getbestblockhash() == best_hash, timeout=120)
+        elapsed_reorg = time.time() - start
+        self.log.info("reorg of %d blocks: %.3fs (%.2fms/block)" %
+                      (REORG_DEPTH, elapsed_reorg, elapsed_reorg * 1000 / REORG_DEPTH))
+
+        # The disconnected transactions spend outputs that exist on both forks and go back to the mempool
+        assert_greater_than(len(node0.getrawmempool()), 0)
+        assert_equal(node0.gettxoutsetinfo()['hash_serialized_2'], node1.gettxoutsetinfo()['hash_serialized_2'])
+        assert(node0.getbalance() <= balance)
+
+if __name__ == '__main__':
+    ReorgBenchmarkTest().main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Ion Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Base class for regtest performance tests.
+
+Performance tests time scenarios on regtest and write the timings as JSON,
+one file per test, so they can be archived and compared between builds:
+
+    {
+      "test": "perf_chain",
+      "scale": 1.0,
+      "timings": [
+        {"name": "generate_blocks", "seconds": 1.234, "count": 200, "ms_per_item": 6.17},
+        ...
+      ]
+    }
+
+Use --perfresultsdir to choose where results are written (default: the test
+tmpdir) and --perfbaselinedir to fail the test when a timing got slower than
+--perftolerance times the timing of the same name in a previous result file.
+--perfscale scales the size of all workloads.
+"""
+
+from contextlib import contextmanager
+import json
+import os
+import sys
+import time
+
+from .test_framework import BitcoinTestFramework
+
+# Timings faster than this are too noisy to compare against a baseline
+MIN_BASELINE_SECONDS = 0.5
+
+class PerfTestFramework(BitcoinTestFramework):
+    """Base class for performance tests.
+
+    Subclasses implement run_perf() instead of run_test() and wrap the timed
+    sections in `with self.measure(name, count):`."""
+
+    def add_options(self, parser):
+        parser.add_option("--perfresultsdir", dest="perfresultsdir",
+                          help="Directory to write the JSON timings to (default: the test tmpdir)")
+        parser.add_option("--perfbaselinedir", dest="perfbaselinedir",
+                          help="Directory with JSON timings of a previous run to compare against")
+        parser.add_option("--perftolerance", dest="perftolerance", default=1.5, type='float',
+                          help="Fail if a timing is slower than this factor times its baseline (default: %default)")
+        parser.add_option("--perfscale", dest="perfscale", default=1.0, type='float',
+                          help="Scale the size of all workloads (default: %default)")
+
+    def scaled(self, count):
+        """Workload size scaled by --perfscale, at least 1"""
+        return max(1, int(count * self.options.perfscale))
+
+    @contextmanager
+    def measure(self, name, count=1):
+        """Time the enclosed block as `name`, covering `count` items"""
+        start = time.time()
+        yield
+        elapsed = time.time() - start
+        self.timings.append({
+            "name": name,
+            "seconds": round(elapsed, 6),
+            "count": count,
+            "ms_per_item": round(elapsed * 1000 / count, 6),
+        })
+        self.log.info("%s: %.3fs for %d items (%.3fms/item)" % (name, elapsed, count, elapsed * 1000 / count))
+
+    def run_perf(self):
+        raise NotImplementedError
+
+    def run_test(self):
+        self.timings = []
+        self.run_perf()
+        self.write_results()
+        self.compare_baseline()
+
+    def test_name(self):
+        return os.path.splitext(os.path.basename(sys.argv[0]))[0]
+
+    def write_results(self):
+        results_dir = self.options.perfresultsdir or self.options.tmpdir
+        os.makedirs(results_dir, exist_ok=True)
+        path = os.path.join(results_dir, self.test_name() + ".json")
+        with open(path, 'w', encoding='utf8') as f:
+            json.dump({
+                "test": self.test_name(),
+                "scale": self.options.perfscale,
+                "timings": self.timings,
+            }, f, indent=2, sort_keys=True)
+        self.log.info("Wrote timings to %s" % path)
+
+    def compare_baseline(self):
+        if not self.options.perfbaselinedir:
+            return
+        path = os.path.join(self.options.perfbaselinedir, self.test_name() + ".json")
+        if not os.path.isfile(path):
+            self.log.warning("No baseline at %s" % path)
+            return
+        with open(path, encoding='utf8') as f:
+            baseline = json.load(f)
+        if baseline.get("scale") != self.options.perfscale:
+            self.log.warning("Baseline was recorded with --perfscale=%s, not comparing" % baseline.get("scale"))
+            return
+
+        baseline_timings = {t["name"]: t for t in baseline["timings"]}
+        regressions = []
+        for timing in self.timings:
+            base = baseline_timings.get(timing["name"])
+            if base is None or base["seconds"] < MIN_BASELINE_SECONDS:
+                continue
+            ratio = timing["seconds"] / base["seconds"]
+            self.log.info("%s: %.2fx of baseline" % (timing["name"], ratio))
+            if ratio > self.options.perftolerance:
+                regressions.append("%s took %.3fs, baseline %.3fs" % (timing["name"], timing["seconds"], base["seconds"]))
+        assert not regressions, "Performance regressions: %s" % "; ".join(regressions)
@@ -168,10 +168,20 @@ EXTENDED_SCRIPTS = [
     'txindex.py',
     'forknotify.py',
     'invalidateblock.py',
+    'reorg_benchmark.py',
+]
+
+PERF_SCRIPTS = [
+    # Performance tests, only run with --perf. They write JSON timings, see
+    # test_framework/perf.py for comparing them against a baseline.
+    'perf_chain.py',
+    'perf_wallet.py',
+    'perf_tokens.py',
+    'perf_dmn.py',
 ]
 
 # Place EXTENDED_SCRIPTS first since it has the 3 longest running tests
-ALL_SCRIPTS = EXTENDED_SCRIPTS + BASE_SCRIPTS
+ALL_SCRIPTS = EXTENDED_SCRIPTS + BASE_SCRIPTS + PERF_SCRIPTS
 
 NON_SCRIPTS = [
     # These are python files that live in the functional tests directory, but are not test scripts.
@@ -197,6 +207,7 @@ def main():
     parser.add_argument('--force', '-f', action='store_true', help='run tests even on platforms where they are disabled by default (e.g. windows).')
     parser.add_argument('--help', '-h', '-?', action='store_true', help='print help text and exit')
     parser.add_argument('--jobs', '-j', type=int, default=4, help='how many test scripts to run in parallel. Default=4.')
+    parser.add_argument('--perf', action='store_true', help='run only the performance tests, one at a time')
     parser.add_argument('--quiet', '-q', action='store_true', help='only print results summary and failure logs')
     parser.add_argument('--keepcache', '-k', action='store_true', help='the default behavior is to flush the cache directory on startup. --keepcache retains the cache from the previous testrun.')
     parser.add_argument('--tmpdirprefix', '-t', default=tempfile.gettempdir(), help="Root directory for datadirs")
@@ -253,7 +264,9 @@ def main():
         # No individual tests have been specified.
         # Run all base tests, and optionally run extended tests.
         test_list = BASE_SCRIPTS
-        if args.extended:
+        if args.perf:
+            test_list = PERF_SCRIPTS
+        elif args.extended:
             # place the EXTENDED_SCRIPTS first since the three longest ones
             # are there and the list is shorter
             test_list = EXTENDED_SCRIPTS + test_list
@@ -283,6 +296,10 @@ def main():
     if not args.keepcache:
         shutil.rmtree("%s/test/cache" % config["environment"]["BUILDDIR"], ignore_errors=True)
 
+    if args.perf:
+        # Parallel tests would skew the timings
+        args.jobs = 1
+
     run_tests(test_list, config["environment"]["SRCDIR"], config["environment"]["BUILDDIR"], config["environment"]["EXEEXT"], tmpdir, args.jobs, args.coverage, passon_args)
 
 def run_tests(test_list, src_dir, build_dir, exeext, tmpdir, jobs=1, enable_coverage=False, args=[]):
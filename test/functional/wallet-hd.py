@@ -96,6 +96,11 @@ class WalletHDTest(BitcoinTestFramework):
         self.start_node(1, extra_args=self.extra_args[1] + ['-rescan'])
         assert_equal(self.nodes[1].getbalance(), num_hd_adds + 1)
 
+        # Restore mode must find the same transactions
+        self.stop_node(1)
+        self.start_node(1, extra_args=self.extra_args[1] + ['-hdrestore'])
+        assert_equal(self.nodes[1].getbalance(), num_hd_adds + 1)
+
         # send a tx and make sure its using the internal chain for the changeoutput
         txid = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1)
         outs = self.nodes[1].decoderawtransaction(self.nodes[1].gettransaction(txid)['hex'])['vout']
@@ -106,5 +111,29 @@ class WalletHDTest(BitcoinTestFramework):
 
         assert_equal(keypath[0:13], "m/44'/1'/0'/1")
 
+        # With -addressindex, restore mode reads the blocks before ATPStartHeight through the
+        # index and has to find token outputs, which the index doesn't cover, by scanning
+        self.log.info("Restore backup with -addressindex ...")
+        self.stop_node(1)
+        self.start_node(1, extra_args=self.extra_args[1] + ['-addressindex', '-reindex'])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.nodes[0].importprivkey("cUnScAFQYLW8J8V9bWr57yj2AopudqTd266s6QuWGMMfMix3Hff4")
+        self.nodes[0].sendtoaddress("gAQQQjA4DCT2EZDVK6Jae4mFfB217V43Nt", 10)
+        self.nodes[0].generate(1)
+        magic_tok = self.nodes[0].configuremanagementtoken("MAGIC", "MagicToken", "4", "https://github.com/ioncoincore/ATP-descriptions/blob/master/ION-testnet-MAGIC.json", "4f92d91db24bb0b8ca24a2ec86c4b012ccdc4b2e9d659c2079f5cc358413a765", "true")
+        self.nodes[0].generate(1)
+        self.nodes[0].minttoken(magic_tok['groupID'], self.nodes[1].getnewaddress(), 500)
+        self.nodes[0].generate(1)
+        self.sync_all()
+        balance = self.nodes[1].getbalance()
+        token_balance = self.nodes[1].gettokenbalance(magic_tok['groupID'])['balance']
+        assert(Decimal(token_balance) > 0)
+
+        self.stop_node(1)
+        shutil.copyfile(tmpdir + "/hd.bak", tmpdir + "/node1/regtest/wallet.dat")
+        self.start_node(1, extra_args=['-usehd=1', '-keypool=400', '-addressindex', '-hdrestore'])
+        assert_equal(self.nodes[1].getbalance(), balance)
+        assert_equal(self.nodes[1].gettokenbalance(magic_tok['groupID'])['balance'], token_balance)
+
 if __name__ == '__main__':
     WalletHDTest().main ()